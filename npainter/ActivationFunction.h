@@ -1,10 +1,16 @@
 #pragma once
 
-#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "ActivationKernels.h"
 
 namespace nn
 {
-	// Abstract activation function
+	// Activation functions. Each function is applied to the whole
+	// layer at once, so the type is dispatched once per layer and
+	// the loop over values can be vectorized
 	class ActivationFunction
 	{
 	public:
@@ -17,130 +23,96 @@ namespace nn
 			ReLU
 		};
 
-		ActivationFunction(Type type) :
-			m_type(type)
-		{}
-
-		virtual ~ActivationFunction() {}
-
-		virtual double evaluate(double x) const = 0;
-
-		virtual double derivative(double x) const = 0;
-
-		Type getType() const { return m_type; }
-
-	protected:
-		Type m_type;
-	};
-
-	// Identity activation function
-	class IdentityActivationFunction : public ActivationFunction
-	{
-	public:
-		IdentityActivationFunction() :
-			ActivationFunction(Type::Identity)
-		{}
-
-		double evaluate(double x) const override
-		{
-			return x;
-		}
-
-		double derivative(double x) const override
-		{
-			return 1.0;
-		}
-	};
-
-	// Sigmoid activation function
-	class SigmoidActivationFunction : public ActivationFunction
-	{
-	public:
-		SigmoidActivationFunction() :
-			ActivationFunction(Type::Sigmoid)
-		{}
-
-		double evaluate(double x) const override
-		{
-			return 1.0 / (1.0 + std::exp(-x));
-		}
-
-		double derivative(double x) const override
+		template<typename T>
+		static void evaluate(Type type, T* values, size_t count, Precision precision = Precision::Exact)
 		{
-			double sigma = evaluate(x);
-			return sigma * (1.0 - sigma);
-		}
-	};
-
-	// Hyperbolic tangent activation function
-	class TanhActivationFunction : public ActivationFunction
-	{
-	public:
-		TanhActivationFunction() :
-			ActivationFunction(Type::Tanh)
-		{}
-
-		double evaluate(double x) const override
-		{
-			return std::tanh(x);
-		}
-
-		double derivative(double x) const override
-		{
-			return 1.0 - std::pow(std::tanh(x), 2.0);
-		}
-	};
-
-	// Hlim activation function
-	class HlimActivationFunction : public ActivationFunction
-	{
-	public:
-		HlimActivationFunction() :
-			ActivationFunction(Type::Hlim)
-		{}
-
-		double evaluate(double x) const override
-		{
-			if (x > 0) {
-				return 1.0;
-			}
-			else {
-				return 0.0;
+			switch (type) {
+			case Type::Identity:
+				break;
+
+			case Type::Sigmoid:
+				kernels::sigmoid(values, count, precision);
+				break;
+
+			case Type::Tanh:
+				kernels::tanh(values, count, precision);
+				break;
+
+			case Type::Hlim:
+				for (size_t i = 0; i < count; ++i) {
+					values[i] = values[i] > T(0) ? T(1) : T(0);
+				}
+				break;
+
+			case Type::ReLU:
+				for (size_t i = 0; i < count; ++i) {
+					values[i] = values[i] > T(0) ? values[i] : T(0);
+				}
+				break;
 			}
 		}
 
-		double derivative(double x) const override
+		template<typename T>
+		static T evaluate(Type type, T x)
 		{
-			return 1.0;
+			evaluate(type, &x, 1);
+			return x;
 		}
-	};
-
-	// ReLU activation function
-	class ReluActivationFunction : public ActivationFunction
-	{
-	public:
-		ReluActivationFunction() :
-			ActivationFunction(Type::ReLU)
-		{}
 
-		double evaluate(double x) const override
+		// Evaluates function and quantizes results to round(255 * y), tanh is
+		// rescaled from [-1, 1]. Sigmoid and tanh use threshold search over
+		// pre-activations, other functions overwrite values with results
+		template<typename T>
+		static void evaluateToBytes(Type type, T* values, size_t count, uint8_t* bytes, size_t bytesStride = 1)
 		{
-			if (x > 0.0) {
-				return x;
-			}
-			else {
-				return 0.0;
+			switch (type) {
+			case Type::Sigmoid:
+				kernels::sigmoidToBytes(values, count, bytes, bytesStride);
+				break;
+
+			case Type::Tanh:
+				kernels::tanhToBytes(values, count, bytes, bytesStride);
+				break;
+
+			default:
+				evaluate(type, values, count);
+				for (size_t i = 0; i < count; ++i) {
+					T value = std::min(std::max(values[i], T(0)), T(1));
+					bytes[i * bytesStride] = static_cast<uint8_t>(value * T(255) + T(0.5));
+				}
+				break;
 			}
 		}
 
-		double derivative(double x) const override
+		// Multiplies gradients by the derivative, expressed through already
+		// computed pre-activations (sums) and outputs, so no function is
+		// evaluated again: sigmoid' = y(1 - y), tanh' = 1 - y^2
+		template<typename T>
+		static void multiplyByDerivative(Type type, const T* sums, const T* outputs, T* gradients, size_t count)
 		{
-			if (x > 0.0) {
-				return 1.0;
-			}
-			else {
-				return 0.0;
+			switch (type) {
+			case Type::Identity:
+			case Type::Hlim:
+				break;
+
+			case Type::Sigmoid:
+				for (size_t i = 0; i < count; ++i) {
+					gradients[i] *= outputs[i] * (T(1) - outputs[i]);
+				}
+				break;
+
+			case Type::Tanh:
+				for (size_t i = 0; i < count; ++i) {
+					gradients[i] *= T(1) - outputs[i] * outputs[i];
+				}
+				break;
+
+			case Type::ReLU:
+				for (size_t i = 0; i < count; ++i) {
+					gradients[i] = sums[i] > T(0) ? gradients[i] : T(0);
+				}
+				break;
 			}
 		}
 	};
-}
\ No newline at end of file
+}
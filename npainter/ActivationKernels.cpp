@@ -0,0 +1,371 @@
+#include "ActivationKernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <vector>
+
+#include "SimdOps.h"
+
+namespace
+{
+	// Near-minimax polynomials for 2^x on [-0.5, 0.5]
+	const double EXP2_COEFFICIENTS_LOW[] = {
+		0.9999245569508709, 0.6931367338836214, 0.24263947854625845, 0.055838282946220126
+	};
+
+	const double EXP2_COEFFICIENTS_MEDIUM[] = {
+		1.0000000754548972, 0.69314718802622866, 0.24022107485308208, 0.055503571142194612,
+		0.009676031918326564, 0.0013390863364533504
+	};
+
+	const double EXP2_COEFFICIENTS_HIGH[] = {
+		0.99999999995956168, 0.69314718055683178, 0.24022651213498097, 0.055504109063279787,
+		0.0096180256133244334, 0.0013333478471918977, 0.00015469729211713235, 1.5303701127683718e-05
+	};
+
+	const double LOG2E = 1.4426950408889634;
+
+	// Sigmoid table covers [-TABLE_RANGE, TABLE_RANGE] with TABLE_STEPS
+	// nodes per unit. Linear interpolation error is h^2 / 8 * max|sigmoid''|
+	const int TABLE_RANGE = 16;
+	const int TABLE_STEPS = 32;
+	const size_t TABLE_SIZE = 2 * TABLE_RANGE * TABLE_STEPS + 1;
+
+	// Thresholds of bytes lie within logit(0.5 / 255) = -6.23 and 6.23. Buckets
+	// are narrower than the smallest distance between thresholds 4 / 255, so
+	// every bucket contains at most one of them
+	const size_t BYTE_LEVELS = 256;
+	const int BUCKETS_RANGE = 8;
+	const int BUCKETS_STEPS = 128;
+	const size_t BUCKETS_COUNT = 2 * BUCKETS_RANGE * BUCKETS_STEPS;
+
+	using nn::simd::ScalarOps;
+	using nn::simd::VectorOps;
+
+	// exp(x) = 2^n * 2^f, where n = round(x * log2(e)) and 2^f is a polynomial
+	template<typename Ops, size_t Degree>
+	typename Ops::Vector exp(typename Ops::Vector x, const double* coefficients)
+	{
+		using Scalar = typename Ops::Scalar;
+		using Vector = typename Ops::Vector;
+
+		Vector t = Ops::mul(x, Ops::set(static_cast<Scalar>(LOG2E)));
+		t = Ops::min(Ops::max(t, Ops::set(-Ops::EXPONENT_LIMIT)), Ops::set(Ops::EXPONENT_LIMIT));
+
+		Vector fraction;
+		Vector scale = Ops::splitExp2(t, fraction);
+
+		Vector result = Ops::set(static_cast<Scalar>(coefficients[Degree]));
+		for (size_t i = Degree; i > 0; --i) {
+			result = Ops::add(Ops::mul(result, fraction), Ops::set(static_cast<Scalar>(coefficients[i - 1])));
+		}
+
+		return Ops::mul(result, scale);
+	}
+
+	// sigmoid(x) = 1 / (1 + exp(-x))
+	template<typename Ops, size_t Degree>
+	typename Ops::Vector sigmoid(typename Ops::Vector x, const double* coefficients)
+	{
+		auto one = Ops::set(1);
+		auto negative = Ops::sub(Ops::set(0), x);
+		return Ops::div(one, Ops::add(one, exp<Ops, Degree>(negative, coefficients)));
+	}
+
+	// tanh(x) = 2 / (1 + exp(-2x)) - 1
+	template<typename Ops, size_t Degree>
+	typename Ops::Vector tanh(typename Ops::Vector x, const double* coefficients)
+	{
+		auto one = Ops::set(1);
+		auto two = Ops::set(2);
+		auto negative = Ops::sub(Ops::set(0), Ops::mul(two, x));
+		return Ops::sub(Ops::div(two, Ops::add(one, exp<Ops, Degree>(negative, coefficients))), one);
+	}
+
+	template<typename T, size_t Degree, bool IsTanh>
+	void applyPolynomial(T* values, size_t count, const double* coefficients)
+	{
+		using Ops = typename VectorOps<T>::Type;
+		using Scalar = ScalarOps<T>;
+
+		size_t i = 0;
+		for (; i + Ops::WIDTH <= count; i += Ops::WIDTH) {
+			auto x = Ops::load(values + i);
+			Ops::store(values + i, IsTanh ?
+				tanh<Ops, Degree>(x, coefficients) :
+				sigmoid<Ops, Degree>(x, coefficients));
+		}
+
+		for (; i < count; ++i) {
+			values[i] = IsTanh ?
+				tanh<Scalar, Degree>(values[i], coefficients) :
+				sigmoid<Scalar, Degree>(values[i], coefficients);
+		}
+	}
+
+	template<typename T>
+	struct SigmoidTable
+	{
+		// One extra node, so the last interval doesn't need special case
+		T values[TABLE_SIZE + 1];
+
+		SigmoidTable()
+		{
+			for (size_t i = 0; i < TABLE_SIZE; ++i) {
+				double x = static_cast<double>(i) / TABLE_STEPS - TABLE_RANGE;
+				values[i] = static_cast<T>(1.0 / (1.0 + std::exp(-x)));
+			}
+			values[TABLE_SIZE] = values[TABLE_SIZE - 1];
+		}
+	};
+
+	// Pre-activations at which round(255 * sigmoid(x)) switches to the next
+	// byte: thresholds[k] = logit((k - 0.5) / 255). The first threshold is
+	// never passed and the last one is never reached. Each bucket keeps
+	// the byte at its lower bound, so search is a lookup and one comparison
+	template<typename T>
+	struct ByteThresholds
+	{
+		T thresholds[BYTE_LEVELS + 1];
+		uint8_t buckets[BUCKETS_COUNT];
+
+		ByteThresholds()
+		{
+			thresholds[0] = std::numeric_limits<T>::lowest();
+			for (size_t k = 1; k < BYTE_LEVELS; ++k) {
+				double y = (k - 0.5) / (BYTE_LEVELS - 1);
+				thresholds[k] = static_cast<T>(std::log(y / (1.0 - y)));
+			}
+			thresholds[BYTE_LEVELS] = std::numeric_limits<T>::max();
+
+			size_t byte = 0;
+			for (size_t i = 0; i < BUCKETS_COUNT; ++i) {
+				T lowerBound = static_cast<T>(static_cast<double>(i) / BUCKETS_STEPS - BUCKETS_RANGE);
+				while (thresholds[byte + 1] <= lowerBound) {
+					++byte;
+				}
+				buckets[i] = static_cast<uint8_t>(byte);
+			}
+		}
+	};
+
+	template<typename T>
+	const SigmoidTable<T>& getSigmoidTable()
+	{
+		static const SigmoidTable<T> table;
+		return table;
+	}
+
+	template<typename T>
+	const ByteThresholds<T>& getByteThresholds()
+	{
+		static const ByteThresholds<T> thresholds;
+		return thresholds;
+	}
+
+	template<typename T>
+	T interpolateSigmoid(const T* table, T x)
+	{
+		// NaN goes to the lower end together with large negative values
+		T position = (std::min(std::max(x, T(-TABLE_RANGE)), T(TABLE_RANGE)) + TABLE_RANGE) * TABLE_STEPS;
+		position = position >= T(0) ? position : T(0);
+
+		int32_t index = static_cast<int32_t>(position);
+		T fraction = position - static_cast<T>(index);
+
+		return table[index] + (table[index + 1] - table[index]) * fraction;
+	}
+
+	template<typename T, bool IsTanh>
+	void applyTable(T* values, size_t count)
+	{
+		const T* table = getSigmoidTable<T>().values;
+
+		for (size_t i = 0; i < count; ++i) {
+			values[i] = IsTanh ?
+				T(2) * interpolateSigmoid(table, T(2) * values[i]) - T(1) :
+				interpolateSigmoid(table, values[i]);
+		}
+	}
+
+	// tanh(x) rescaled to [0, 1] is sigmoid(2x), so both share thresholds
+	template<typename T>
+	void applyThresholds(const T* values, size_t count, T scale, uint8_t* bytes, size_t bytesStride)
+	{
+		const ByteThresholds<T>& search = getByteThresholds<T>();
+		const T* thresholds = search.thresholds;
+
+		for (size_t i = 0; i < count; ++i) {
+			T x = values[i] * scale;
+
+			T position = (std::min(std::max(x, T(-BUCKETS_RANGE)), T(BUCKETS_RANGE)) + BUCKETS_RANGE) * BUCKETS_STEPS;
+			position = position >= T(0) ? position : T(0);
+			int32_t bucket = std::min(static_cast<int32_t>(position), static_cast<int32_t>(BUCKETS_COUNT - 1));
+
+			// Correcting for the threshold inside the bucket and for rounding of position
+			int32_t byte = search.buckets[bucket];
+			byte += thresholds[byte + 1] <= x ? 1 : 0;
+			byte -= x < thresholds[byte] ? 1 : 0;
+
+			bytes[i * bytesStride] = static_cast<uint8_t>(byte);
+		}
+	}
+
+	const double REPORT_RANGE = 20.0;
+	const size_t REPORT_PASSES = 16;
+
+	const char* const PRECISION_NAMES[] = { "Exact", "High", "Medium", "Low", "Table" };
+
+	template<typename T, bool IsTanh>
+	void applyPrecision(T* values, size_t count, nn::Precision precision)
+	{
+		switch (precision) {
+		case nn::Precision::Exact:
+			for (size_t i = 0; i < count; ++i) {
+				values[i] = IsTanh ? std::tanh(values[i]) : T(1) / (T(1) + std::exp(-values[i]));
+			}
+			break;
+
+		case nn::Precision::High:
+			applyPolynomial<T, 7, IsTanh>(values, count, EXP2_COEFFICIENTS_HIGH);
+			break;
+
+		case nn::Precision::Medium:
+			applyPolynomial<T, 5, IsTanh>(values, count, EXP2_COEFFICIENTS_MEDIUM);
+			break;
+
+		case nn::Precision::Low:
+			applyPolynomial<T, 3, IsTanh>(values, count, EXP2_COEFFICIENTS_LOW);
+			break;
+
+		case nn::Precision::Table:
+			applyTable<T, IsTanh>(values, count);
+			break;
+		}
+	}
+}
+
+namespace
+{
+	template<typename T>
+	std::vector<T> makeReportInputs(size_t count)
+	{
+		std::vector<T> inputs(count);
+		for (size_t i = 0; i < count; ++i) {
+			inputs[i] = static_cast<T>(-REPORT_RANGE + 2.0 * REPORT_RANGE * i / (count - 1));
+		}
+		return inputs;
+	}
+
+	template<typename T, bool IsTanh>
+	void printFunctionReport(const char* typeName, size_t count)
+	{
+		std::vector<T> inputs = makeReportInputs<T>(count);
+		std::vector<T> values(count);
+
+		for (size_t tier = 0; tier < sizeof(PRECISION_NAMES) / sizeof(PRECISION_NAMES[0]); ++tier) {
+			nn::Precision precision = static_cast<nn::Precision>(tier);
+
+			// Kernels work in place, so inputs are restored outside of the timed region
+			std::chrono::duration<double, std::nano> time(0.0);
+			for (size_t pass = 0; pass < REPORT_PASSES; ++pass) {
+				std::copy(inputs.begin(), inputs.end(), values.begin());
+
+				auto start = std::chrono::high_resolution_clock::now();
+				applyPrecision<T, IsTanh>(values.data(), count, precision);
+				time += std::chrono::high_resolution_clock::now() - start;
+			}
+
+			long double maxError = 0.0L;
+			for (size_t i = 0; i < count; ++i) {
+				long double x = inputs[i];
+				long double expected = IsTanh ? std::tanh(x) : 1.0L / (1.0L + std::exp(-x));
+				maxError = std::max(maxError, std::fabs(static_cast<long double>(values[i]) - expected));
+			}
+
+			printf("%-7s %-8s %-7s max error %.2e, %.2f ns/value\n", typeName, IsTanh ? "tanh" : "sigmoid",
+				PRECISION_NAMES[tier], static_cast<double>(maxError), time.count() / (REPORT_PASSES * count));
+		}
+	}
+
+	template<typename T, bool IsTanh>
+	void printBytesReport(const char* typeName, size_t count)
+	{
+		std::vector<T> inputs = makeReportInputs<T>(count);
+		std::vector<uint8_t> bytes(count);
+
+		std::chrono::duration<double, std::nano> time(0.0);
+		for (size_t pass = 0; pass < REPORT_PASSES; ++pass) {
+			auto start = std::chrono::high_resolution_clock::now();
+			applyThresholds(inputs.data(), count, IsTanh ? T(2) : T(1), bytes.data(), 1);
+			time += std::chrono::high_resolution_clock::now() - start;
+		}
+
+		size_t mismatches = 0;
+		for (size_t i = 0; i < count; ++i) {
+			long double x = inputs[i];
+			long double y = IsTanh ? (std::tanh(x) + 1.0L) / 2.0L : 1.0L / (1.0L + std::exp(-x));
+			if (bytes[i] != static_cast<uint8_t>(std::lround(255.0L * y))) {
+				++mismatches;
+			}
+		}
+
+		printf("%-7s %-8s %-7s %zu mismatched bytes, %.2f ns/value\n", typeName, IsTanh ? "tanh" : "sigmoid",
+			"Bytes", mismatches, time.count() / (REPORT_PASSES * count));
+	}
+
+	template<typename T>
+	void printTypeReport(const char* typeName, size_t count)
+	{
+		printFunctionReport<T, false>(typeName, count);
+		printFunctionReport<T, true>(typeName, count);
+		printBytesReport<T, false>(typeName, count);
+		printBytesReport<T, true>(typeName, count);
+	}
+}
+
+template<typename T>
+void nn::kernels::sigmoid(T* values, size_t count, Precision precision)
+{
+	applyPrecision<T, false>(values, count, precision);
+}
+
+template<typename T>
+void nn::kernels::tanh(T* values, size_t count, Precision precision)
+{
+	applyPrecision<T, true>(values, count, precision);
+}
+
+template<typename T>
+void nn::kernels::sigmoidToBytes(const T* values, size_t count, uint8_t* bytes, size_t bytesStride)
+{
+	applyThresholds(values, count, T(1), bytes, bytesStride);
+}
+
+template<typename T>
+void nn::kernels::tanhToBytes(const T* values, size_t count, uint8_t* bytes, size_t bytesStride)
+{
+	applyThresholds(values, count, T(2), bytes, bytesStride);
+}
+
+void nn::kernels::printPrecisionReport(size_t count)
+{
+	count = std::max(count, static_cast<size_t>(2));
+
+	printf("Activation kernels over [-%g, %g], %zu values\n", REPORT_RANGE, REPORT_RANGE, count);
+	printTypeReport<float>("float", count);
+	printTypeReport<double>("double", count);
+}
+
+template void nn::kernels::sigmoid<float>(float* values, size_t count, Precision precision);
+template void nn::kernels::sigmoid<double>(double* values, size_t count, Precision precision);
+template void nn::kernels::tanh<float>(float* values, size_t count, Precision precision);
+template void nn::kernels::tanh<double>(double* values, size_t count, Precision precision);
+
+template void nn::kernels::sigmoidToBytes<float>(const float* values, size_t count, uint8_t* bytes, size_t bytesStride);
+template void nn::kernels::sigmoidToBytes<double>(const double* values, size_t count, uint8_t* bytes, size_t bytesStride);
+template void nn::kernels::tanhToBytes<float>(const float* values, size_t count, uint8_t* bytes, size_t bytesStride);
+template void nn::kernels::tanhToBytes<double>(const double* values, size_t count, uint8_t* bytes, size_t bytesStride);
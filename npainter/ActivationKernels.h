@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nn
+{
+	// Accuracy of transcendental activation functions. Approximate tiers
+	// replace std::exp with a polynomial, evaluated with SSE2 or AVX2:
+	//   High   - relative error of exp ~5e-11
+	//   Medium - relative error of exp ~1e-7
+	//   Low    - relative error of exp ~1e-4, still far below 8-bit output step
+	// Table tier doesn't evaluate exp at all, it interpolates a precomputed
+	// sigmoid table over [-16, 16], absolute error of sigmoid ~1e-5
+	enum class Precision
+	{
+		Exact,
+		High,
+		Medium,
+		Low,
+		Table
+	};
+
+	namespace kernels
+	{
+		template<typename T>
+		void sigmoid(T* values, size_t count, Precision precision);
+
+		template<typename T>
+		void tanh(T* values, size_t count, Precision precision);
+
+		// Map pre-activations straight to round(255 * y), where y is sigmoid
+		// or tanh rescaled to [0, 1], so no function is evaluated. A table of
+		// 2048 buckets over [-8, 8] gives the byte at the start of the bucket,
+		// which is corrected by comparing with the neighbour precomputed
+		// thresholds. Byte of value i is written to bytes[i * bytesStride]
+		template<typename T>
+		void sigmoidToBytes(const T* values, size_t count, uint8_t* bytes, size_t bytesStride = 1);
+
+		template<typename T>
+		void tanhToBytes(const T* values, size_t count, uint8_t* bytes, size_t bytesStride = 1);
+
+		// Sweeps count values over [-20, 20] through every tier of both types and
+		// prints max absolute error against a long double reference and time per
+		// value. Byte kernels report mismatches with round(255 * y)
+		void printPrecisionReport(size_t count = 1 << 20);
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+namespace utils
+{
+	// Number of allocations made by AlignedAllocator. Used to
+	// check that steady state loops don't allocate memory
+	inline std::atomic<size_t>& alignedAllocationsCounter()
+	{
+		static std::atomic<size_t> counter(0);
+		return counter;
+	}
+
+	inline size_t getAlignedAllocationsCount()
+	{
+		return alignedAllocationsCounter().load(std::memory_order_relaxed);
+	}
+
+	// Allocator which places storage at the cache line boundary
+	template<typename T, size_t Alignment = 64>
+	class AlignedAllocator
+	{
+	public:
+		using value_type = T;
+
+		template<typename U>
+		struct rebind
+		{
+			using other = AlignedAllocator<U, Alignment>;
+		};
+
+		AlignedAllocator() = default;
+
+		template<typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment>&)
+		{}
+
+		T* allocate(size_t count)
+		{
+			if (count == 0) {
+				return nullptr;
+			}
+
+			size_t size = count * sizeof(T);
+
+#ifdef _MSC_VER
+			void* pointer = _aligned_malloc(size, Alignment);
+#else
+			void* pointer = nullptr;
+			if (posix_memalign(&pointer, Alignment, size) != 0) {
+				pointer = nullptr;
+			}
+#endif
+			if (pointer == nullptr) {
+				throw std::bad_alloc();
+			}
+
+			alignedAllocationsCounter().fetch_add(1, std::memory_order_relaxed);
+
+			return static_cast<T*>(pointer);
+		}
+
+		void deallocate(T* pointer, size_t)
+		{
+#ifdef _MSC_VER
+			_aligned_free(pointer);
+#else
+			free(pointer);
+#endif
+		}
+	};
+
+	template<typename T, typename U, size_t Alignment>
+	bool operator==(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&)
+	{
+		return true;
+	}
+
+	template<typename T, typename U, size_t Alignment>
+	bool operator!=(const AlignedAllocator<T, Alignment>&, const AlignedAllocator<U, Alignment>&)
+	{
+		return false;
+	}
+
+	template<typename T>
+	using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+}
@@ -0,0 +1,113 @@
+#include "Conv2DLayer.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+template<typename T>
+nn::Conv2DLayer<T>::Conv2DLayer(const Layer<T>& layer, size_t kernelRadius, size_t inputChannels) :
+	m_activationType(layer.getActivationType()), m_activationPrecision(layer.getActivationPrecision()),
+	m_kernelRadius(kernelRadius), m_kernelSide(kernelRadius * 2 + 1),
+	m_inputChannels(inputChannels), m_outputChannels(layer.getOutputsCount())
+{
+	size_t kernelArea = m_kernelSide * m_kernelSide;
+
+	if (layer.getInputsCount() != kernelArea * inputChannels) {
+		throw std::runtime_error("Layer inputs don't match kernel size");
+	}
+
+	m_weights.resize(m_outputChannels * inputChannels * kernelArea);
+	m_biases.assign(layer.getBiases(), layer.getBiases() + m_outputChannels);
+
+	// Patch input (i * side + j) * channels + c holds pixel at offset
+	// (i - radius, j - radius), where i goes along x and j along y
+	for (size_t o = 0; o < m_outputChannels; ++o) {
+		const T* row = layer.getWeights() + o * layer.getInputsCount();
+
+		for (size_t c = 0; c < inputChannels; ++c) {
+			T* kernel = m_weights.data() + (o * inputChannels + c) * kernelArea;
+
+			for (size_t j = 0; j < m_kernelSide; ++j) {
+				for (size_t i = 0; i < m_kernelSide; ++i) {
+					kernel[j * m_kernelSide + i] = row[(i * m_kernelSide + j) * inputChannels + c];
+				}
+			}
+		}
+	}
+}
+
+template<typename T>
+size_t nn::Conv2DLayer<T>::getKernelRadius() const
+{
+	return m_kernelRadius;
+}
+
+template<typename T>
+size_t nn::Conv2DLayer<T>::getInputChannels() const
+{
+	return m_inputChannels;
+}
+
+template<typename T>
+size_t nn::Conv2DLayer<T>::getOutputChannels() const
+{
+	return m_outputChannels;
+}
+
+template<typename T>
+void nn::Conv2DLayer<T>::feedForward(const T* inputs, size_t width, size_t rows, T* outputs) const
+{
+	size_t paddedWidth = width + 2 * m_kernelRadius;
+	size_t paddedPlane = paddedWidth * (rows + 2 * m_kernelRadius);
+	size_t kernelArea = m_kernelSide * m_kernelSide;
+
+	// Outputs are computed in short runs of pixels, which are kept in
+	// registers while all weights of the channel are applied to them
+	const size_t runLength = 8;
+
+	for (size_t o = 0; o < m_outputChannels; ++o) {
+		const T* kernels = m_weights.data() + o * m_inputChannels * kernelArea;
+
+		for (size_t y = 0; y < rows; ++y) {
+			T* output = outputs + (o * rows + y) * width;
+
+			for (size_t first = 0; first < width; first += runLength) {
+				size_t count = std::min(runLength, width - first);
+
+				T sums[runLength];
+				for (size_t x = 0; x < runLength; ++x) {
+					sums[x] = m_biases[o];
+				}
+
+				for (size_t c = 0; c < m_inputChannels; ++c) {
+					const T* kernel = kernels + c * kernelArea;
+					const T* plane = inputs + c * paddedPlane + first;
+
+					for (size_t j = 0; j < m_kernelSide; ++j) {
+						for (size_t i = 0; i < m_kernelSide; ++i) {
+							const T weight = kernel[j * m_kernelSide + i];
+							const T* input = plane + (y + j) * paddedWidth + i;
+
+							if (count == runLength) {
+								for (size_t x = 0; x < runLength; ++x) {
+									sums[x] += weight * input[x];
+								}
+							}
+							else {
+								for (size_t x = 0; x < count; ++x) {
+									sums[x] += weight * input[x];
+								}
+							}
+						}
+					}
+				}
+
+				std::copy(sums, sums + count, output + first);
+			}
+		}
+	}
+
+	ActivationFunction::evaluate(m_activationType, outputs, m_outputChannels * rows * width, m_activationPrecision);
+}
+
+template class nn::Conv2DLayer<float>;
+template class nn::Conv2DLayer<double>;
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Layer.h"
+
+namespace nn
+{
+	// Convolution with a square (2 * radius + 1) kernel, which applies
+	// the same weights around every pixel of an image. Images are stored
+	// planar (channels x rows x width). Weights are stored as
+	// outputChannels x inputChannels x kernelSide x kernelSide
+	template<typename T>
+	class Conv2DLayer
+	{
+	public:
+		// Converts the first layer of a network trained on patches.
+		// Layer inputs must be ordered like MainWindow::generateKernel
+		// offsets: column by column, each pixel holding all channels
+		Conv2DLayer(const Layer<T>& layer, size_t kernelRadius, size_t inputChannels);
+
+		size_t getKernelRadius() const;
+		size_t getInputChannels() const;
+		size_t getOutputChannels() const;
+
+		// Inputs must be padded by the kernel radius on every side, so they
+		// are inputChannels x (rows + 2 * radius) x (width + 2 * radius)
+		void feedForward(const T* inputs, size_t width, size_t rows, T* outputs) const;
+
+	private:
+		ActivationFunction::Type m_activationType;
+		Precision m_activationPrecision;
+
+		size_t m_kernelRadius;
+		size_t m_kernelSide;
+		size_t m_inputChannels;
+		size_t m_outputChannels;
+
+		utils::AlignedVector<T> m_weights;
+		utils::AlignedVector<T> m_biases;
+	};
+}
@@ -0,0 +1,114 @@
+#include "ConvNetwork.h"
+
+#include <algorithm>
+
+template<typename T>
+const size_t nn::ConvNetwork<T>::TILE_WIDTH;
+
+template<typename T>
+const size_t nn::ConvNetwork<T>::TILE_ROWS;
+
+template<typename T>
+nn::ConvNetwork<T>::ConvNetwork(const Network<T>& network, size_t kernelRadius, size_t channels) :
+	m_channels(channels), m_convolution(network.getLayers().front(), kernelRadius, channels),
+	m_layers(network.getLayers().begin() + 1, network.getLayers().end())
+{
+	size_t maxLayerSize = m_convolution.getOutputChannels();
+	for (auto& layer : m_layers) {
+		maxLayerSize = std::max(maxLayerSize, layer.getOutputsCount());
+	}
+
+	size_t paddedWidth = TILE_WIDTH + 2 * kernelRadius;
+	size_t paddedRows = TILE_ROWS + 2 * kernelRadius;
+
+	m_tileInputs.resize(channels * paddedWidth * paddedRows);
+	m_tileValues.resize(maxLayerSize * TILE_WIDTH * TILE_ROWS);
+	m_tileOutputs.resize(maxLayerSize * TILE_WIDTH * TILE_ROWS);
+}
+
+template<typename T>
+void nn::ConvNetwork<T>::evaluate(const T* image, size_t width, size_t height, T* outputs)
+{
+	size_t outputsCount = getOutputsCount();
+
+	for (size_t top = 0; top < height; top += TILE_ROWS) {
+		size_t tileRows = std::min(TILE_ROWS, height - top);
+
+		for (size_t left = 0; left < width; left += TILE_WIDTH) {
+			size_t tileWidth = std::min(TILE_WIDTH, width - left);
+			size_t tileSize = tileWidth * tileRows;
+
+			loadTile(image, width, height, left, top, tileWidth, tileRows);
+
+			T* layerInputs = m_tileValues.data();
+			T* layerOutputs = m_tileOutputs.data();
+
+			// Planar tile is the same as feature-major batch of its pixels
+			m_convolution.feedForward(m_tileInputs.data(), tileWidth, tileRows, layerInputs);
+
+			for (auto& layer : m_layers) {
+				layer.feedForward(layerInputs, tileSize, layerOutputs);
+				std::swap(layerInputs, layerOutputs);
+			}
+
+			for (size_t y = 0; y < tileRows; ++y) {
+				T* output = outputs + ((top + y) * width + left) * outputsCount;
+
+				for (size_t x = 0; x < tileWidth; ++x) {
+					for (size_t o = 0; o < outputsCount; ++o) {
+						output[x * outputsCount + o] = layerInputs[o * tileSize + y * tileWidth + x];
+					}
+				}
+			}
+		}
+	}
+}
+
+template<typename T>
+size_t nn::ConvNetwork<T>::getKernelRadius() const
+{
+	return m_convolution.getKernelRadius();
+}
+
+template<typename T>
+size_t nn::ConvNetwork<T>::getOutputsCount() const
+{
+	if (m_layers.empty()) {
+		return m_convolution.getOutputChannels();
+	}
+
+	return m_layers.back().getOutputsCount();
+}
+
+template<typename T>
+void nn::ConvNetwork<T>::loadTile(const T* image, size_t width, size_t height,
+	size_t left, size_t top, size_t tileWidth, size_t tileRows)
+{
+	// Copying tile with its border to planar layout, clamping
+	// coordinates the same way as patches are gathered for training
+	int radius = static_cast<int>(m_convolution.getKernelRadius());
+
+	size_t paddedWidth = tileWidth + 2 * radius;
+	size_t paddedRows = tileRows + 2 * radius;
+	size_t paddedPlane = paddedWidth * paddedRows;
+
+	int maxX = static_cast<int>(width) - 1;
+	int maxY = static_cast<int>(height) - 1;
+
+	for (size_t y = 0; y < paddedRows; ++y) {
+		int sourceY = std::min(std::max(static_cast<int>(top + y) - radius, 0), maxY);
+		const T* row = image + sourceY * width * m_channels;
+
+		for (size_t x = 0; x < paddedWidth; ++x) {
+			int sourceX = std::min(std::max(static_cast<int>(left + x) - radius, 0), maxX);
+			const T* pixel = row + sourceX * m_channels;
+
+			for (size_t c = 0; c < m_channels; ++c) {
+				m_tileInputs[c * paddedPlane + y * paddedWidth + x] = pixel[c];
+			}
+		}
+	}
+}
+
+template class nn::ConvNetwork<float>;
+template class nn::ConvNetwork<double>;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "Conv2DLayer.h"
+#include "Network.h"
+
+namespace nn
+{
+	// Whole-image form of a network trained on patches around each pixel.
+	// The first layer becomes a convolution, the rest are applied to every
+	// pixel as 1x1 convolutions. Image is processed in tiles, so that all
+	// intermediate values of a tile stay in cache
+	template<typename T>
+	class ConvNetwork
+	{
+	public:
+		static const size_t TILE_WIDTH = 64;
+		static const size_t TILE_ROWS = 4;
+
+		ConvNetwork(const Network<T>& network, size_t kernelRadius, size_t channels = 3);
+
+		// Image and outputs are interleaved (height x width x channels).
+		// Pixels outside of the image replicate the nearest border pixel
+		void evaluate(const T* image, size_t width, size_t height, T* outputs);
+
+		size_t getKernelRadius() const;
+		size_t getOutputsCount() const;
+
+	private:
+		void loadTile(const T* image, size_t width, size_t height,
+			size_t left, size_t top, size_t tileWidth, size_t tileRows);
+
+		size_t m_channels;
+
+		Conv2DLayer<T> m_convolution;
+		std::vector<Layer<T>> m_layers;
+
+		utils::AlignedVector<T> m_tileInputs;
+		utils::AlignedVector<T> m_tileValues;
+		utils::AlignedVector<T> m_tileOutputs;
+	};
+}
@@ -0,0 +1,205 @@
+#include "FannConverter.h"
+
+#include <stdexcept>
+
+#include <doublefann.h>
+
+template<typename T>
+nn::Network<T> nn::importFann(struct fann* network)
+{
+	if (fann_get_network_type(network) != FANN_NETTYPE_LAYER) {
+		throw std::runtime_error("Only layered FANN networks can be imported");
+	}
+
+	unsigned int layersCount = fann_get_num_layers(network);
+	if (layersCount < 3) {
+		throw std::runtime_error("Network must contain input and output layers, and at least one hidden");
+	}
+
+	std::vector<unsigned int> sizes(layersCount);
+	fann_get_layer_array(network, sizes.data());
+
+	// Every FANN layer is followed by a bias neuron, including the output one
+	std::vector<unsigned int> firstNeurons(layersCount, 0);
+	size_t expectedConnectionsCount = 0;
+	for (unsigned int l = 1; l < layersCount; ++l) {
+		firstNeurons[l] = firstNeurons[l - 1] + sizes[l - 1] + 1;
+		expectedConnectionsCount += (sizes[l - 1] + 1) * sizes[l];
+	}
+
+	unsigned int connectionsCount = fann_get_total_connections(network);
+	if (connectionsCount != expectedConnectionsCount) {
+		throw std::runtime_error("Only fully connected FANN networks can be imported");
+	}
+
+	std::vector<fann_connection> connections(connectionsCount);
+	fann_get_connection_array(network, connections.data());
+
+	std::vector<std::vector<double>> weights(layersCount);
+	std::vector<std::vector<double>> biases(layersCount);
+	for (unsigned int l = 1; l < layersCount; ++l) {
+		weights[l].resize(sizes[l - 1] * sizes[l]);
+		biases[l].resize(sizes[l]);
+	}
+
+	for (auto& connection : connections) {
+		// Finding layer of the destination neuron
+		unsigned int l = layersCount - 1;
+		while (connection.to_neuron < firstNeurons[l]) {
+			--l;
+		}
+
+		if (l == 0 || connection.from_neuron < firstNeurons[l - 1]) {
+			throw std::runtime_error("Only fully connected FANN networks can be imported");
+		}
+
+		unsigned int neuron = connection.to_neuron - firstNeurons[l];
+		unsigned int input = connection.from_neuron - firstNeurons[l - 1];
+
+		if (neuron >= sizes[l] || input > sizes[l - 1]) {
+			throw std::runtime_error("Only fully connected FANN networks can be imported");
+		}
+
+		if (input == sizes[l - 1]) {
+			biases[l][neuron] = connection.weight;
+		}
+		else {
+			weights[l][neuron * sizes[l - 1] + input] = connection.weight;
+		}
+	}
+
+	// Converting activations, whole layer must use the same function
+	std::vector<Layer<T>> layers;
+	layers.reserve(layersCount - 1);
+
+	for (unsigned int l = 1; l < layersCount; ++l) {
+		fann_activationfunc_enum function = fann_get_activation_function(network, l, 0);
+		double steepness = fann_get_activation_steepness(network, l, 0);
+
+		for (unsigned int i = 1; i < sizes[l]; ++i) {
+			if (fann_get_activation_function(network, l, i) != function ||
+				fann_get_activation_steepness(network, l, i) != steepness)
+			{
+				throw std::runtime_error("FANN layer neurons must share activation function");
+			}
+		}
+
+		ActivationFunction::Type type;
+		double scale;
+
+		switch (function) {
+		case FANN_LINEAR:
+			type = ActivationFunction::Type::Identity;
+			scale = steepness;
+			break;
+
+		case FANN_SIGMOID:
+			// 1 / (1 + exp(-2 * s * x))
+			type = ActivationFunction::Type::Sigmoid;
+			scale = 2.0 * steepness;
+			break;
+
+		case FANN_SIGMOID_SYMMETRIC:
+			// tanh(s * x)
+			type = ActivationFunction::Type::Tanh;
+			scale = steepness;
+			break;
+
+		default:
+			throw std::runtime_error("Unsupported FANN activation function");
+		}
+
+		for (auto& weight : weights[l]) {
+			weight *= scale;
+		}
+
+		for (auto& bias : biases[l]) {
+			bias *= scale;
+		}
+
+		// Weights are folded in double and rounded to T once
+		std::vector<T> layerWeights(weights[l].begin(), weights[l].end());
+		std::vector<T> layerBiases(biases[l].begin(), biases[l].end());
+		layers.emplace_back(sizes[l - 1], sizes[l], type, layerWeights.data(), layerBiases.data());
+	}
+
+	return Network<T>(sizes[0], layers);
+}
+
+struct fann* nn::exportFann(const Network<double>& network)
+{
+	const std::vector<Layer<double>>& layers = network.getLayers();
+
+	std::vector<unsigned int> sizes;
+	sizes.push_back(static_cast<unsigned int>(network.getInputsCount()));
+	for (auto& layer : layers) {
+		sizes.push_back(static_cast<unsigned int>(layer.getOutputsCount()));
+	}
+
+	unsigned int layersCount = static_cast<unsigned int>(sizes.size());
+
+	// Activations with steepness, which keeps weights unchanged
+	for (auto& layer : layers) {
+		ActivationFunction::Type type = layer.getActivationType();
+		if (type != ActivationFunction::Type::Identity && type != ActivationFunction::Type::Sigmoid &&
+			type != ActivationFunction::Type::Tanh)
+		{
+			throw std::runtime_error("Layer activation function can't be exported to FANN");
+		}
+	}
+
+	struct fann* result = fann_create_standard_array(layersCount, sizes.data());
+	if (result == nullptr) {
+		throw std::runtime_error("Can't create FANN network");
+	}
+
+	for (unsigned int l = 1; l < layersCount; ++l) {
+		switch (layers[l - 1].getActivationType()) {
+		case ActivationFunction::Type::Sigmoid:
+			fann_set_activation_function_layer(result, FANN_SIGMOID, l);
+			fann_set_activation_steepness_layer(result, 0.5, l);
+			break;
+
+		case ActivationFunction::Type::Tanh:
+			fann_set_activation_function_layer(result, FANN_SIGMOID_SYMMETRIC, l);
+			fann_set_activation_steepness_layer(result, 1.0, l);
+			break;
+
+		default:
+			fann_set_activation_function_layer(result, FANN_LINEAR, l);
+			fann_set_activation_steepness_layer(result, 1.0, l);
+			break;
+		}
+	}
+
+	std::vector<unsigned int> firstNeurons(layersCount, 0);
+	for (unsigned int l = 1; l < layersCount; ++l) {
+		firstNeurons[l] = firstNeurons[l - 1] + sizes[l - 1] + 1;
+	}
+
+	unsigned int connectionsCount = fann_get_total_connections(result);
+	std::vector<fann_connection> connections(connectionsCount);
+	fann_get_connection_array(result, connections.data());
+
+	for (auto& connection : connections) {
+		unsigned int l = layersCount - 1;
+		while (connection.to_neuron < firstNeurons[l]) {
+			--l;
+		}
+
+		const Layer<double>& layer = layers[l - 1];
+		unsigned int neuron = connection.to_neuron - firstNeurons[l];
+		unsigned int input = connection.from_neuron - firstNeurons[l - 1];
+
+		connection.weight = input == sizes[l - 1] ?
+			layer.getBiases()[neuron] :
+			layer.getWeights()[neuron * sizes[l - 1] + input];
+	}
+
+	fann_set_weight_array(result, connections.data(), connectionsCount);
+
+	return result;
+}
+
+template nn::Network<float> nn::importFann(struct fann* network);
+template nn::Network<double> nn::importFann(struct fann* network);
\ No newline at end of file
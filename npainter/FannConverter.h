@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Network.h"
+
+struct fann;
+
+namespace nn
+{
+	// Conversion between FANN networks of doublefann and nn networks.
+	// Only fully connected layered networks with linear, sigmoid and
+	// symmetric sigmoid activations are supported. FANN steepness is
+	// folded into weights. Throws std::runtime_error for other networks
+	template<typename T>
+	Network<T> importFann(struct fann* network);
+
+	// Returned network must be released with fann_destroy
+	struct fann* exportFann(const Network<double>& network);
+}
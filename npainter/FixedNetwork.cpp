@@ -0,0 +1,153 @@
+#include "FixedNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+template<typename T>
+nn::FixedNetwork::FixedNetwork(const Network<T>& network) :
+	m_inputsCount(network.getInputsCount())
+{
+	const std::vector<Layer<T>>& layers = network.getLayers();
+
+	// Selecting decimal point, so that weights fit into 16 bits
+	// and worst case sum of each neuron fits into 32 bits
+	double maxWeight = 0.0;
+	double maxSum = 0.0;
+	size_t maxLayerSize = m_inputsCount;
+
+	for (auto& layer : layers) {
+		ActivationFunction::Type type = layer.getActivationType();
+		if (type != ActivationFunction::Type::Sigmoid && type != ActivationFunction::Type::Tanh) {
+			throw std::runtime_error("Fixed point network supports only sigmoid and tanh layers");
+		}
+
+		const T* weights = layer.getWeights();
+		const T* biases = layer.getBiases();
+
+		for (size_t i = 0; i < layer.getOutputsCount(); ++i) {
+			double sum = std::abs(static_cast<double>(biases[i]));
+			maxWeight = std::max(maxWeight, sum);
+
+			for (size_t j = 0; j < layer.getInputsCount(); ++j) {
+				double weight = std::abs(static_cast<double>(weights[i * layer.getInputsCount() + j]));
+				maxWeight = std::max(maxWeight, weight);
+				sum += weight;
+			}
+
+			maxSum = std::max(maxSum, sum);
+		}
+
+		maxLayerSize = std::max(maxLayerSize, layer.getOutputsCount());
+	}
+
+	m_decimalPoint = MAX_DECIMAL_POINT;
+	while (m_decimalPoint > 0 &&
+		(maxWeight * std::ldexp(1.0, m_decimalPoint) > std::numeric_limits<int16_t>::max() ||
+			maxSum * std::ldexp(1.0, 2 * m_decimalPoint) > std::numeric_limits<int32_t>::max()))
+	{
+		--m_decimalPoint;
+	}
+
+	if (m_decimalPoint < ACTIVATION_TABLE_RESOLUTION_BITS) {
+		throw std::runtime_error("Network weights are too large for fixed point representation");
+	}
+
+	// Converting layers
+	double multiplier = std::ldexp(1.0, m_decimalPoint);
+	size_t tableSize = (2 * ACTIVATION_TABLE_RANGE << ACTIVATION_TABLE_RESOLUTION_BITS) + 1;
+
+	m_layers.resize(layers.size());
+	for (size_t l = 0; l < layers.size(); ++l) {
+		const Layer<T>& layer = layers[l];
+		FixedLayer& fixedLayer = m_layers[l];
+
+		fixedLayer.inputsCount = layer.getInputsCount();
+		fixedLayer.outputsCount = layer.getOutputsCount();
+
+		size_t weightsCount = fixedLayer.inputsCount * fixedLayer.outputsCount;
+		fixedLayer.weights.resize(weightsCount);
+		for (size_t i = 0; i < weightsCount; ++i) {
+			fixedLayer.weights[i] = static_cast<int16_t>(std::lround(layer.getWeights()[i] * multiplier));
+		}
+
+		fixedLayer.biases.resize(fixedLayer.outputsCount);
+		for (size_t i = 0; i < fixedLayer.outputsCount; ++i) {
+			fixedLayer.biases[i] = static_cast<int32_t>(std::lround(layer.getBiases()[i] * multiplier * multiplier));
+		}
+
+		fixedLayer.activationTable.resize(tableSize);
+		for (size_t i = 0; i < tableSize; ++i) {
+			double x = std::ldexp(static_cast<double>(i), -ACTIVATION_TABLE_RESOLUTION_BITS) - ACTIVATION_TABLE_RANGE;
+			double y = ActivationFunction::evaluate(layer.getActivationType(), x);
+			fixedLayer.activationTable[i] = static_cast<int16_t>(std::lround(y * multiplier));
+		}
+	}
+
+	m_inputs.resize(maxLayerSize);
+	m_outputs.resize(maxLayerSize);
+}
+
+void nn::FixedNetwork::evaluate(const int16_t* inputs, size_t batch, int16_t* outputs)
+{
+	size_t outputsCount = m_layers.back().outputsCount;
+
+	for (size_t k = 0; k < batch; ++k) {
+		std::copy(inputs + k * m_inputsCount, inputs + (k + 1) * m_inputsCount, m_inputs.begin());
+
+		for (auto& layer : m_layers) {
+			const int16_t* weights = layer.weights.data();
+			const int16_t* layerInputs = m_inputs.data();
+
+			for (size_t i = 0; i < layer.outputsCount; ++i) {
+				const int16_t* row = weights + i * layer.inputsCount;
+
+				int32_t sum = layer.biases[i];
+				for (size_t j = 0; j < layer.inputsCount; ++j) {
+					sum += static_cast<int32_t>(row[j]) * static_cast<int32_t>(layerInputs[j]);
+				}
+
+				m_outputs[i] = activate(layer, sum >> m_decimalPoint);
+			}
+
+			std::swap(m_inputs, m_outputs);
+		}
+
+		std::copy(m_inputs.begin(), m_inputs.begin() + outputsCount, outputs + k * outputsCount);
+	}
+}
+
+int nn::FixedNetwork::getDecimalPoint() const
+{
+	return m_decimalPoint;
+}
+
+int16_t nn::FixedNetwork::toFixed(double value) const
+{
+	return static_cast<int16_t>(std::lround(std::ldexp(value, m_decimalPoint)));
+}
+
+double nn::FixedNetwork::fromFixed(int16_t value) const
+{
+	return std::ldexp(static_cast<double>(value), -m_decimalPoint);
+}
+
+int16_t nn::FixedNetwork::activate(const FixedLayer& layer, int32_t x) const
+{
+	// Linear interpolation between two nearest table values
+	int shift = m_decimalPoint - ACTIVATION_TABLE_RESOLUTION_BITS;
+	int32_t range = ACTIVATION_TABLE_RANGE << m_decimalPoint;
+
+	int32_t position = std::min(std::max(x + range, 0), 2 * range - 1);
+	int32_t index = position >> shift;
+	int32_t fraction = position & ((1 << shift) - 1);
+
+	int32_t left = layer.activationTable[index];
+	int32_t right = layer.activationTable[index + 1];
+
+	return static_cast<int16_t>(left + (((right - left) * fraction) >> shift));
+}
+
+template nn::FixedNetwork::FixedNetwork(const Network<float>& network);
+template nn::FixedNetwork::FixedNetwork(const Network<double>& network);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Network.h"
+
+namespace nn
+{
+	// Inference-only copy of a trained network in 16-bit fixed point.
+	// Weights and values have getDecimalPoint() fractional bits and are
+	// accumulated in 32-bit integers. Inputs must be within [-1, 1], and
+	// only sigmoid and tanh layers are supported
+	class FixedNetwork
+	{
+	public:
+		template<typename T>
+		FixedNetwork(const Network<T>& network);
+
+		void evaluate(const int16_t* inputs, size_t batch, int16_t* outputs);
+
+		int getDecimalPoint() const;
+		int16_t toFixed(double value) const;
+		double fromFixed(int16_t value) const;
+
+	private:
+		struct FixedLayer
+		{
+			size_t inputsCount;
+			size_t outputsCount;
+
+			utils::AlignedVector<int16_t> weights;
+			utils::AlignedVector<int32_t> biases;
+
+			// Activation values sampled with ACTIVATION_TABLE_RESOLUTION
+			// step over [-ACTIVATION_TABLE_RANGE, ACTIVATION_TABLE_RANGE]
+			utils::AlignedVector<int16_t> activationTable;
+		};
+
+		int16_t activate(const FixedLayer& layer, int32_t x) const;
+
+		static const int ACTIVATION_TABLE_RANGE = 8;
+		static const int ACTIVATION_TABLE_RESOLUTION_BITS = 6;
+		static const int MAX_DECIMAL_POINT = 14;
+
+		size_t m_inputsCount;
+		std::vector<FixedLayer> m_layers;
+		int m_decimalPoint;
+
+		utils::AlignedVector<int16_t> m_inputs;
+		utils::AlignedVector<int16_t> m_outputs;
+	};
+}
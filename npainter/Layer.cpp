@@ -0,0 +1,251 @@
+#include "Layer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Random.h"
+
+template<typename T>
+nn::Layer<T>::Layer(size_t inputsCount, size_t outputsCount, ActivationFunction::Type activationType) :
+	m_activationType(activationType), m_activationPrecision(Precision::Exact), m_inputsCount(inputsCount), m_outputsCount(outputsCount),
+	m_weights(inputsCount * outputsCount), m_biases(outputsCount),
+	m_weightsState(Optimizer::STATE_SIZE * inputsCount * outputsCount), m_biasesState(Optimizer::STATE_SIZE * outputsCount)
+{
+	// Small symmetric weights keep neurons out of saturation
+	double range = 1.0 / std::sqrt(static_cast<double>(inputsCount));
+
+	for (auto& weight : m_weights) {
+		weight = static_cast<T>((utils::random() * 2.0 - 1.0) * range);
+	}
+
+	for (auto& bias : m_biases) {
+		bias = static_cast<T>((utils::random() * 2.0 - 1.0) * range);
+	}
+
+	resetOptimizerState(Optimizer());
+}
+
+template<typename T>
+nn::Layer<T>::Layer(size_t inputsCount, size_t outputsCount, ActivationFunction::Type activationType,
+	const T* weights, const T* biases) :
+	m_activationType(activationType), m_activationPrecision(Precision::Exact), m_inputsCount(inputsCount), m_outputsCount(outputsCount),
+	m_weights(weights, weights + inputsCount * outputsCount), m_biases(biases, biases + outputsCount),
+	m_weightsState(Optimizer::STATE_SIZE * inputsCount * outputsCount), m_biasesState(Optimizer::STATE_SIZE * outputsCount)
+{
+	resetOptimizerState(Optimizer());
+}
+
+template<typename T>
+size_t nn::Layer<T>::getInputsCount() const
+{
+	return m_inputsCount;
+}
+
+template<typename T>
+size_t nn::Layer<T>::getOutputsCount() const
+{
+	return m_outputsCount;
+}
+
+template<typename T>
+const T* nn::Layer<T>::getWeights() const
+{
+	return m_weights.data();
+}
+
+template<typename T>
+const T* nn::Layer<T>::getBiases() const
+{
+	return m_biases.data();
+}
+
+template<typename T>
+nn::ActivationFunction::Type nn::Layer<T>::getActivationType() const
+{
+	return m_activationType;
+}
+
+template<typename T>
+void nn::Layer<T>::setActivationPrecision(Precision precision)
+{
+	m_activationPrecision = precision;
+}
+
+template<typename T>
+nn::Precision nn::Layer<T>::getActivationPrecision() const
+{
+	return m_activationPrecision;
+}
+
+template<typename T>
+void nn::Layer<T>::feedForward(const T* inputs, T* values) const
+{
+	computeSums(inputs, values);
+	ActivationFunction::evaluate(m_activationType, values, m_outputsCount, m_activationPrecision);
+}
+
+template<typename T>
+void nn::Layer<T>::feedForward(const T* inputs, T* sums, T* values) const
+{
+	computeSums(inputs, sums);
+
+	std::copy(sums, sums + m_outputsCount, values);
+	ActivationFunction::evaluate(m_activationType, values, m_outputsCount, m_activationPrecision);
+}
+
+template<typename T>
+void nn::Layer<T>::feedForward(const T* inputs, size_t batch, T* outputs) const
+{
+	computeSums(inputs, batch, outputs);
+	ActivationFunction::evaluate(m_activationType, outputs, m_outputsCount * batch, m_activationPrecision);
+}
+
+template<typename T>
+void nn::Layer<T>::feedForward(const T* inputs, size_t batch, T* sums, uint8_t* outputs) const
+{
+	computeSums(inputs, batch, sums);
+
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		ActivationFunction::evaluateToBytes(m_activationType, sums + i * batch, batch, outputs + i, m_outputsCount);
+	}
+}
+
+template<typename T>
+void nn::Layer<T>::applyDerivative(const T* sums, const T* values, T* gradients) const
+{
+	ActivationFunction::multiplyByDerivative(m_activationType, sums, values, gradients, m_outputsCount);
+}
+
+template<typename T>
+void nn::Layer<T>::backPropagate(const T* gradients, T* previousGradients) const
+{
+	// previousGradients = transposed(weights) * gradients, walking
+	// weight rows in order so that memory is read sequentially
+	for (size_t j = 0; j < m_inputsCount; ++j) {
+		previousGradients[j] = T(0);
+	}
+
+	const T* weights = m_weights.data();
+
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		const T* row = weights + i * m_inputsCount;
+		T gradient = gradients[i];
+
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			previousGradients[j] += row[j] * gradient;
+		}
+	}
+}
+
+template<typename T>
+void nn::Layer<T>::accumulateGradients(const T* inputs, const T* gradients, T* weightGradients, T* biasGradients) const
+{
+	// Outer product of neuron gradients and layer inputs
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		T gradient = gradients[i];
+		T* row = weightGradients + i * m_inputsCount;
+
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			row[j] += gradient * inputs[j];
+		}
+
+		biasGradients[i] += gradient;
+	}
+}
+
+template<typename T>
+void nn::Layer<T>::updateWeights(const Optimizer& optimizer, const T* weightGradients, const T* biasGradients, size_t batch,
+	size_t step)
+{
+	const T gradientScale = T(1) / static_cast<T>(batch);
+
+	optimizer.update(m_weights.data(), weightGradients, m_weightsState.data(), m_weights.size(), gradientScale, step);
+	optimizer.update(m_biases.data(), biasGradients, m_biasesState.data(), m_biases.size(), gradientScale, step);
+
+	if (!m_weightsMask.empty()) {
+		for (size_t i = 0; i < m_weights.size(); ++i) {
+			m_weights[i] *= m_weightsMask[i];
+		}
+	}
+}
+
+template<typename T>
+void nn::Layer<T>::resetOptimizerState(const Optimizer& optimizer)
+{
+	optimizer.resetState(m_weightsState.data(), m_weights.size());
+	optimizer.resetState(m_biasesState.data(), m_biases.size());
+}
+
+template<typename T>
+size_t nn::Layer<T>::prune(T threshold)
+{
+	if (m_weightsMask.empty()) {
+		m_weightsMask.resize(m_weights.size(), T(1));
+	}
+
+	size_t zerosCount = 0;
+	for (size_t i = 0; i < m_weights.size(); ++i) {
+		if (std::abs(m_weights[i]) < threshold) {
+			m_weightsMask[i] = T(0);
+		}
+
+		m_weights[i] *= m_weightsMask[i];
+		zerosCount += m_weights[i] == T(0) ? 1 : 0;
+	}
+
+	return zerosCount;
+}
+
+template<typename T>
+bool nn::Layer<T>::isPruned() const
+{
+	return !m_weightsMask.empty();
+}
+
+template<typename T>
+void nn::Layer<T>::computeSums(const T* inputs, T* sums) const
+{
+	const T* weights = m_weights.data();
+
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		const T* row = weights + i * m_inputsCount;
+
+		T sum = m_biases[i];
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			sum += row[j] * inputs[j];
+		}
+
+		sums[i] = sum;
+	}
+}
+
+template<typename T>
+void nn::Layer<T>::computeSums(const T* inputs, size_t batch, T* outputs) const
+{
+	// Inputs and outputs are stored feature-major (inputsCount x batch and
+	// outputsCount x batch), so the innermost loop runs over samples and
+	// every weight is loaded once per batch instead of once per sample
+	const T* weights = m_weights.data();
+
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		const T* row = weights + i * m_inputsCount;
+		T* output = outputs + i * batch;
+
+		T bias = m_biases[i];
+		for (size_t k = 0; k < batch; ++k) {
+			output[k] = bias;
+		}
+
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			const T weight = row[j];
+			const T* input = inputs + j * batch;
+
+			for (size_t k = 0; k < batch; ++k) {
+				output[k] += weight * input[k];
+			}
+		}
+	}
+}
+
+template class nn::Layer<float>;
+template class nn::Layer<double>;
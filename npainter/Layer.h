@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ActivationFunction.h"
+#include "AlignedAllocator.h"
+#include "Optimizer.h"
+
+namespace nn
+{
+	// Fully connected layer. Weights are stored as row-major
+	// outputsCount x inputsCount matrix, so each neuron reads
+	// its input weights from one contiguous row. Layer holds only
+	// parameters, all per-sample buffers are passed by the caller,
+	// so that several threads can use one layer at the same time
+	template<typename T>
+	class Layer
+	{
+	public:
+		Layer(size_t inputsCount, size_t outputsCount, ActivationFunction::Type activationType);
+		// Creates layer with given parameters, weights are in the layout of getWeights()
+		Layer(size_t inputsCount, size_t outputsCount, ActivationFunction::Type activationType,
+			const T* weights, const T* biases);
+
+		size_t getInputsCount() const;
+		size_t getOutputsCount() const;
+
+		const T* getWeights() const;
+		const T* getBiases() const;
+
+		ActivationFunction::Type getActivationType() const;
+
+		void setActivationPrecision(Precision precision);
+		Precision getActivationPrecision() const;
+
+		void feedForward(const T* inputs, T* values) const;
+		// Training variant, keeps pre-activations for the backward pass
+		void feedForward(const T* inputs, T* sums, T* values) const;
+		void feedForward(const T* inputs, size_t batch, T* outputs) const;
+		// Output layer variant for 8-bit results, see ActivationFunction::evaluateToBytes.
+		// Sums receive pre-activations, outputs are written sample-major (batch x outputsCount)
+		void feedForward(const T* inputs, size_t batch, T* sums, uint8_t* outputs) const;
+
+		// Multiplies neuron gradients by the derivative of activation function,
+		// sums and values are the ones saved by the training feedForward
+		void applyDerivative(const T* sums, const T* values, T* gradients) const;
+		void backPropagate(const T* gradients, T* previousGradients) const;
+
+		// Adds gradients of the current sample to the batch sums
+		void accumulateGradients(const T* inputs, const T* gradients, T* weightGradients, T* biasGradients) const;
+		// Applies averaged batch gradients using the optimizer. Step is
+		// the number of the network update starting from 1
+		void updateWeights(const Optimizer& optimizer, const T* weightGradients, const T* biasGradients, size_t batch,
+			size_t step);
+		// Must be called when optimizer of the layer changes
+		void resetOptimizerState(const Optimizer& optimizer);
+
+		// Zeroes weights with magnitude below the threshold. Pruned weights
+		// stay zero during further training. Returns count of zero weights
+		size_t prune(T threshold);
+		bool isPruned() const;
+
+	private:
+		void computeSums(const T* inputs, T* sums) const;
+		void computeSums(const T* inputs, size_t batch, T* sums) const;
+
+		ActivationFunction::Type m_activationType;
+		Precision m_activationPrecision;
+
+		size_t m_inputsCount;
+		size_t m_outputsCount;
+
+		utils::AlignedVector<T> m_weights;
+		utils::AlignedVector<T> m_biases;
+
+		// 1 for kept and 0 for pruned weights, empty if layer isn't pruned
+		utils::AlignedVector<T> m_weightsMask;
+
+		// Optimizer::STATE_SIZE planes for weights and biases
+		utils::AlignedVector<T> m_weightsState;
+		utils::AlignedVector<T> m_biasesState;
+	};
+}
@@ -1,18 +1,124 @@
 #include "MainWindow.h"
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <thread>
 
+#include <QtWidgets/qboxlayout.h>
 #include <QtWidgets/qgridlayout.h>
 #include <QtWidgets/qmessagebox.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qfileinfo.h>
 #include <QtCore/qstandardpaths.h>
 #include <QtGui/qguiapplication.h>
 #include <QtGui/qimagereader.h>
 #include <QtGui/qimagewriter.h>
 
+#include "FannConverter.h"
+#include "ModelFile.h"
+#include "PatchRowExtractor.h"
+
+namespace
+{
+	// Coarsest preview step, previews are refined by halving it
+	const int MAX_PREVIEW_STEP = 8;
+	// Preview time while training improves, in milliseconds
+	const double PREVIEW_LATENCY_BUDGET = 100.0;
+
+	// Smaller relative MSE improvements don't count as progress
+	const float CONVERGENCE_TOLERANCE = 0.01f;
+	const unsigned int CONVERGENCE_EPOCHS = 5;
+
+	// Weight of older iterations in the shown training duty cycle
+	const double DUTY_CYCLE_DECAY = 0.9;
+
+	// Events posted by the evaluation thread, widgets are changed only by the UI thread
+	class TrainingErrorEvent : public QEvent
+	{
+	public:
+		static const QEvent::Type TYPE;
+
+		TrainingErrorEvent(const QString& message) :
+			QEvent(TYPE), m_message(message)
+		{
+		}
+
+		const QString& getMessage() const
+		{
+			return m_message;
+		}
+
+	private:
+		QString m_message;
+	};
+
+	class PreviewImageEvent : public QEvent
+	{
+	public:
+		static const QEvent::Type TYPE;
+
+		PreviewImageEvent(const QImage& image) :
+			QEvent(TYPE), m_image(image)
+		{
+		}
+
+		const QImage& getImage() const
+		{
+			return m_image;
+		}
+
+	private:
+		QImage m_image;
+	};
+
+	class DutyCycleEvent : public QEvent
+	{
+	public:
+		static const QEvent::Type TYPE;
+
+		DutyCycleEvent(double dutyCycle) :
+			QEvent(TYPE), m_dutyCycle(dutyCycle)
+		{
+		}
+
+		double getDutyCycle() const
+		{
+			return m_dutyCycle;
+		}
+
+	private:
+		double m_dutyCycle;
+	};
+
+	class EvaluationFinishedEvent : public QEvent
+	{
+	public:
+		static const QEvent::Type TYPE;
+
+		EvaluationFinishedEvent() :
+			QEvent(TYPE)
+		{
+		}
+	};
+
+	const QEvent::Type TrainingErrorEvent::TYPE = static_cast<QEvent::Type>(QEvent::registerEventType());
+	const QEvent::Type PreviewImageEvent::TYPE = static_cast<QEvent::Type>(QEvent::registerEventType());
+	const QEvent::Type DutyCycleEvent::TYPE = static_cast<QEvent::Type>(QEvent::registerEventType());
+	const QEvent::Type EvaluationFinishedEvent::TYPE = static_cast<QEvent::Type>(QEvent::registerEventType());
+}
+
 MainWindow::MainWindow(QWidget* parent) :
-	QMainWindow(parent), m_isEvaluating(false)
+	QMainWindow(parent), m_fannTrainingData(nullptr), m_isFannTrainingDataComplete(false), m_fannEpochData(),
+	m_trainingAlgorithm(FANN_TRAIN_INCREMENTAL), m_learningRate(0.7f), m_learningMomentum(0.0f),
+	m_samplingPolicy(static_cast<int>(utils::TrainingSampler::Policy::All)), m_samplesPerEpoch(65536),
+	m_samplingOrder(static_cast<int>(utils::TrainingSampler::Order::Shuffled)), m_samplingSeed(1), m_epochsCount(0),
+	m_bestMse(std::numeric_limits<float>::infinity()), m_epochsWithoutImprovement(0),
+	m_isPreviewNetworkOutdated(true), m_previewStep(MAX_PREVIEW_STEP), m_previewPixelTime(0.0),
+	m_previewShare(0.1f), m_previewCredit(0.0), m_trainingTime(0.0), m_previewTime(0.0),
+	m_publishedNetwork(nullptr), m_pendingNetwork(nullptr), m_isEvaluating(false), m_isClosing(false)
 {
 	// Creating window layout
 
@@ -62,6 +168,102 @@ MainWindow::MainWindow(QWidget* parent) :
 	m_buttonEvaluate->setEnabled(false);
 	gridLayout->addWidget(m_buttonEvaluate, 3, 1, 1, 1);
 
+	m_buttonSaveNetwork = new QPushButton(centralwidget);
+	m_buttonSaveNetwork->setText("Save network");
+	gridLayout->addWidget(m_buttonSaveNetwork, 4, 0, 1, 1);
+
+	m_buttonLoadNetwork = new QPushButton(centralwidget);
+	m_buttonLoadNetwork->setText("Load network");
+	gridLayout->addWidget(m_buttonLoadNetwork, 4, 1, 1, 1);
+
+	// Creating training parameters
+	m_comboTrainingAlgorithm = new QComboBox(centralwidget);
+	m_comboTrainingAlgorithm->addItem("Incremental", FANN_TRAIN_INCREMENTAL);
+	m_comboTrainingAlgorithm->addItem("Batch", FANN_TRAIN_BATCH);
+	m_comboTrainingAlgorithm->addItem("RPROP", FANN_TRAIN_RPROP);
+	m_comboTrainingAlgorithm->addItem("Quickprop", FANN_TRAIN_QUICKPROP);
+	m_comboTrainingAlgorithm->addItem("SARPROP", FANN_TRAIN_SARPROP);
+	gridLayout->addWidget(m_comboTrainingAlgorithm, 5, 0, 1, 1);
+
+	QWidget* learningParameters = new QWidget(centralwidget);
+	QHBoxLayout* learningLayout = new QHBoxLayout(learningParameters);
+	learningLayout->setContentsMargins(0, 0, 0, 0);
+
+	m_spinLearningRate = new QDoubleSpinBox(learningParameters);
+	m_spinLearningRate->setRange(0.0, 10.0);
+	m_spinLearningRate->setDecimals(3);
+	m_spinLearningRate->setSingleStep(0.05);
+	m_spinLearningRate->setValue(m_learningRate);
+	learningLayout->addWidget(new QLabel("Learning rate", learningParameters));
+	learningLayout->addWidget(m_spinLearningRate);
+
+	m_spinLearningMomentum = new QDoubleSpinBox(learningParameters);
+	m_spinLearningMomentum->setRange(0.0, 1.0);
+	m_spinLearningMomentum->setDecimals(3);
+	m_spinLearningMomentum->setSingleStep(0.05);
+	m_spinLearningMomentum->setValue(m_learningMomentum);
+	learningLayout->addWidget(new QLabel("Momentum", learningParameters));
+	learningLayout->addWidget(m_spinLearningMomentum);
+
+	gridLayout->addWidget(learningParameters, 5, 1, 1, 1);
+
+	m_comboSamplingPolicy = new QComboBox(centralwidget);
+	m_comboSamplingPolicy->addItem("All pixels", static_cast<int>(utils::TrainingSampler::Policy::All));
+	m_comboSamplingPolicy->addItem("Uniform subset", static_cast<int>(utils::TrainingSampler::Policy::Uniform));
+	m_comboSamplingPolicy->addItem("Stratified subset", static_cast<int>(utils::TrainingSampler::Policy::Stratified));
+	gridLayout->addWidget(m_comboSamplingPolicy, 6, 0, 1, 1);
+
+	QWidget* samplingParameters = new QWidget(centralwidget);
+	QHBoxLayout* samplingLayout = new QHBoxLayout(samplingParameters);
+	samplingLayout->setContentsMargins(0, 0, 0, 0);
+
+	m_spinSamplesPerEpoch = new QSpinBox(samplingParameters);
+	m_spinSamplesPerEpoch->setRange(256, 16 * 1024 * 1024);
+	m_spinSamplesPerEpoch->setSingleStep(4096);
+	m_spinSamplesPerEpoch->setValue(m_samplesPerEpoch);
+	m_spinSamplesPerEpoch->setEnabled(false);
+	samplingLayout->addWidget(new QLabel("Samples per epoch", samplingParameters));
+	samplingLayout->addWidget(m_spinSamplesPerEpoch);
+
+	gridLayout->addWidget(samplingParameters, 6, 1, 1, 1);
+
+	m_comboSamplingOrder = new QComboBox(centralwidget);
+	m_comboSamplingOrder->addItem("Raster order", static_cast<int>(utils::TrainingSampler::Order::Raster));
+	m_comboSamplingOrder->addItem("Shuffled", static_cast<int>(utils::TrainingSampler::Order::Shuffled));
+	m_comboSamplingOrder->addItem("Block shuffled", static_cast<int>(utils::TrainingSampler::Order::BlockShuffled));
+	m_comboSamplingOrder->setCurrentIndex(m_comboSamplingOrder->findData(m_samplingOrder.load()));
+	gridLayout->addWidget(m_comboSamplingOrder, 7, 0, 1, 1);
+
+	QWidget* orderParameters = new QWidget(centralwidget);
+	QHBoxLayout* orderLayout = new QHBoxLayout(orderParameters);
+	orderLayout->setContentsMargins(0, 0, 0, 0);
+
+	// Same seed repeats the same epochs after training data is prepared again
+	m_spinSamplingSeed = new QSpinBox(orderParameters);
+	m_spinSamplingSeed->setRange(0, std::numeric_limits<int>::max());
+	m_spinSamplingSeed->setValue(m_samplingSeed);
+	orderLayout->addWidget(new QLabel("Seed", orderParameters));
+	orderLayout->addWidget(m_spinSamplingSeed);
+
+	gridLayout->addWidget(orderParameters, 7, 1, 1, 1);
+
+	QWidget* previewParameters = new QWidget(centralwidget);
+	QHBoxLayout* previewLayout = new QHBoxLayout(previewParameters);
+	previewLayout->setContentsMargins(0, 0, 0, 0);
+
+	m_spinPreviewShare = new QDoubleSpinBox(previewParameters);
+	m_spinPreviewShare->setRange(1.0, 100.0);
+	m_spinPreviewShare->setDecimals(0);
+	m_spinPreviewShare->setSuffix("%");
+	m_spinPreviewShare->setValue(m_previewShare * 100.0);
+	previewLayout->addWidget(new QLabel("Preview time limit", previewParameters));
+	previewLayout->addWidget(m_spinPreviewShare);
+
+	gridLayout->addWidget(previewParameters, 8, 0, 1, 1);
+
+	m_labelDutyCycle = new QLabel(centralwidget);
+	gridLayout->addWidget(m_labelDutyCycle, 8, 1, 1, 1);
+
 	// Assigning
 	setCentralWidget(centralwidget);
 
@@ -71,6 +273,43 @@ MainWindow::MainWindow(QWidget* parent) :
 	connect(m_buttonTrainingOutput, &QPushButton::pressed, this, &MainWindow::onSelectTrainingOutput);
 	connect(m_buttonSource, &QPushButton::pressed, this, &MainWindow::onSelectInput);
 	connect(m_buttonEvaluate, &QPushButton::pressed, this, &MainWindow::onEvaluate);
+	connect(m_buttonSaveNetwork, &QPushButton::pressed, this, &MainWindow::onSaveNetwork);
+	connect(m_buttonLoadNetwork, &QPushButton::pressed, this, &MainWindow::onLoadNetwork);
+
+	connect(m_comboTrainingAlgorithm, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [this](int index) {
+		m_trainingAlgorithm = m_comboTrainingAlgorithm->itemData(index).toInt();
+	});
+	connect(m_spinLearningRate, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+		m_learningRate = static_cast<float>(value);
+	});
+	connect(m_spinLearningMomentum, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+		m_learningMomentum = static_cast<float>(value);
+	});
+	connect(m_comboSamplingPolicy, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [this](int index) {
+		m_samplingPolicy = m_comboSamplingPolicy->itemData(index).toInt();
+		m_spinSamplesPerEpoch->setEnabled(m_samplingPolicy != static_cast<int>(utils::TrainingSampler::Policy::All));
+	});
+	connect(m_spinSamplesPerEpoch, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+		m_samplesPerEpoch = value;
+	});
+	connect(m_comboSamplingOrder, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, [this](int index) {
+		m_samplingOrder = m_comboSamplingOrder->itemData(index).toInt();
+	});
+	connect(m_spinSamplingSeed, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, [this](int value) {
+		m_samplingSeed = value;
+	});
+	connect(m_spinPreviewShare, static_cast<void (QDoubleSpinBox::*)(double)>(&QDoubleSpinBox::valueChanged), this, [this](double value) {
+		m_previewShare = static_cast<float>(value / 100.0);
+	});
+
+	m_networkWatcher = new QFileSystemWatcher(this);
+	connect(m_networkWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::onNetworkFileChanged);
+	connect(m_networkWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString&) {
+		// Replaced file is removed from the watcher, it's noticed again in its directory
+		if (!m_watchedNetworkFile.isEmpty() && !m_networkWatcher->files().contains(m_watchedNetworkFile)) {
+			onNetworkFileChanged(m_watchedNetworkFile);
+		}
+	});
 
 
 	// Initializing neural network
@@ -84,9 +323,21 @@ MainWindow::MainWindow(QWidget* parent) :
 
 MainWindow::~MainWindow()
 {
+	m_isClosing = true;
 	m_isEvaluating = false;
-	std::unique_lock<std::mutex> lock(m_evaluationMutex);
+	if (m_evaluationThread.joinable()) {
+		m_evaluationThread.join();
+	}
+
+	releaseTrainingData();
 	fann_destroy(m_network);
+
+	if (m_publishedNetwork != nullptr) {
+		fann_destroy(m_publishedNetwork);
+	}
+	if (m_pendingNetwork != nullptr) {
+		fann_destroy(m_pendingNetwork);
+	}
 }
 
 // Main events handling //
@@ -106,10 +357,11 @@ void MainWindow::onSelectTrainingSource()
 
 	if (newImage != nullptr) {
 		m_trainingSource = std::move(newImage);
-		m_trainingSource->convertToFormat(QImage::Format_RGB32);
+		*m_trainingSource = m_trainingSource->convertToFormat(QImage::Format_RGB32);
 		m_labelLeft->setPixmap(QPixmap::fromImage(*m_trainingSource));
 
 		m_trainingOutput.reset(nullptr);
+		releaseTrainingData();
 		m_labelRight->clear();
 
 		m_buttonEvaluate->setEnabled(m_trainingSource != nullptr && m_trainingOutput != nullptr &&
@@ -138,9 +390,11 @@ void MainWindow::onSelectTrainingOutput()
 
 	if (newImage != nullptr) {
 		m_trainingOutput = std::move(newImage);
-		m_trainingOutput->convertToFormat(QImage::Format_RGB32);
+		*m_trainingOutput = m_trainingOutput->convertToFormat(QImage::Format_RGB32);
 		m_labelRight->setPixmap(QPixmap::fromImage(*m_trainingOutput));
 
+		prepareTrainingData();
+
 		m_buttonEvaluate->setEnabled(m_trainingSource != nullptr && m_trainingOutput != nullptr &&
 			m_inputImage != nullptr);
 	}
@@ -160,8 +414,9 @@ void MainWindow::onSelectInput()
 
 	if (newImage != nullptr) {
 		m_inputImage = std::move(newImage);
-		m_inputImage->convertToFormat(QImage::Format_RGB32);
+		*m_inputImage = m_inputImage->convertToFormat(QImage::Format_RGB32);
 		m_labelLeft->setPixmap(QPixmap::fromImage(*m_inputImage));
+		prepareInputImage();
 
 		m_resultImage = std::make_unique<QImage>(m_inputImage->size(), QImage::Format_RGB32);
 		m_labelRight->setPixmap(QPixmap::fromImage(*m_resultImage));
@@ -171,16 +426,28 @@ void MainWindow::onSelectInput()
 	}
 }
 
-void MainWindow::onEvaluate()
+void MainWindow::customEvent(QEvent* event)
 {
-	if (m_isEvaluating) {
-		m_isEvaluating = false;
+	if (event->type() == TrainingErrorEvent::TYPE) {
+		QMessageBox::warning(this, "Error", static_cast<TrainingErrorEvent*>(event)->getMessage());
+	}
+	else if (event->type() == PreviewImageEvent::TYPE) {
+		m_labelRight->setPixmap(QPixmap::fromImage(static_cast<PreviewImageEvent*>(event)->getImage()));
+	}
+	else if (event->type() == DutyCycleEvent::TYPE) {
+		double dutyCycle = static_cast<DutyCycleEvent*>(event)->getDutyCycle();
+		m_labelDutyCycle->setText(QString("Training duty cycle: %1%").arg(100.0 * dutyCycle, 0, 'f', 0));
+	}
+	else if (event->type() == EvaluationFinishedEvent::TYPE) {
+		finishEvaluation();
+	}
+}
 
-		std::unique_lock<std::mutex> lock(m_evaluationMutex);
-		m_buttonTrainingSource->setEnabled(true);
-		m_buttonTrainingOutput->setEnabled(true);
-		m_buttonSource->setEnabled(true);
-		m_buttonEvaluate->setText("Evaluate");
+void MainWindow::onEvaluate()
+{
+	// Thread is joined only when it has exited, it may have stopped by itself
+	if (m_evaluationThread.joinable()) {
+		stopEvaluation();
 	}
 	else {
 		m_buttonTrainingSource->setEnabled(false);
@@ -188,112 +455,496 @@ void MainWindow::onEvaluate()
 		m_buttonSource->setEnabled(false);
 		m_buttonEvaluate->setText("Stop");
 
+		// Every run starts from the seed, so equal seeds give equal epoch orders
+		if (m_trainingSampler != nullptr) {
+			m_trainingSampler->setSeed(static_cast<uint32_t>(m_samplingSeed.load()));
+		}
+
 		m_isEvaluating = true;
+		publishNetwork();
 
-		std::thread([this]() {
+		m_evaluationThread = std::thread([this]() {
 			while (m_isEvaluating) {
 				std::unique_lock<std::mutex> lock(m_evaluationMutex);
+				applyPendingNetwork();
+
+				auto start = std::chrono::high_resolution_clock::now();
 				train();
-				preview();
+				auto trained = std::chrono::high_resolution_clock::now();
+
+				int step = schedulePreview(std::chrono::duration<double, std::milli>(trained - start).count());
+				if (step != 0) {
+					preview(step);
+				}
+				auto previewed = std::chrono::high_resolution_clock::now();
+
+				updateDutyCycle(std::chrono::duration<double, std::milli>(trained - start).count(),
+					std::chrono::duration<double, std::milli>(previewed - trained).count());
+
+				publishNetwork();
 			}
-		}).detach();
+
+			refinePreview();
+		});
 	}
 }
 
+void MainWindow::stopEvaluation()
+{
+	m_isEvaluating = false;
 
-void MainWindow::train()
+	m_buttonEvaluate->setEnabled(false);
+	m_buttonEvaluate->setText("Stopping");
+}
+
+void MainWindow::finishEvaluation()
 {
-	const QRgb* trainingSource = reinterpret_cast<const QRgb*>(m_trainingSource->bits());
-	const QRgb* trainingOutput = reinterpret_cast<const QRgb*>(m_trainingOutput->bits());
+	m_evaluationThread.join();
+	m_buttonEvaluate->setText("Evaluate");
 
-	QSize size = m_trainingSource->size();
+	// Network may be loaded after the thread has swapped in the last one
+	std::unique_lock<std::mutex> lock(m_networkExchangeMutex);
+	bool isNetworkPending = m_pendingNetwork != nullptr;
+	lock.unlock();
 
-	for (int y = 0; y < size.height(); ++y) {
-		for (int x = 0; x < size.width(); ++x) {
-			QPoint point(x, y);
+	if (isNetworkPending) {
+		startRefinement();
+		return;
+	}
 
-			std::vector<double> pixels(m_kernel.size() * 3);
-			for (size_t i = 0; i < m_kernel.size(); ++i) {
-				QPoint pointToSelect = point + m_kernel[i];
+	m_buttonTrainingSource->setEnabled(true);
+	m_buttonTrainingOutput->setEnabled(true);
+	m_buttonSource->setEnabled(true);
+	m_buttonEvaluate->setEnabled(m_trainingSource != nullptr && m_trainingOutput != nullptr &&
+		m_inputImage != nullptr);
+}
 
-				if (pointToSelect.x() < 0) {
-					pointToSelect.setX(0);
-				}
-				if (pointToSelect.y() < 0) {
-					pointToSelect.setY(0);
-				}
+void MainWindow::startRefinement()
+{
+	m_buttonTrainingSource->setEnabled(false);
+	m_buttonTrainingOutput->setEnabled(false);
+	m_buttonSource->setEnabled(false);
+	m_buttonEvaluate->setEnabled(false);
 
-				if (pointToSelect.x() >= size.width()) {
-					pointToSelect.setX(size.width() - 1);
-				}
-				if (pointToSelect.y() >= size.height()) {
-					pointToSelect.setY(size.height() - 1);
-				}
+	publishNetwork();
 
-				QRgb color = trainingSource[pointToSelect.y() * size.width() + pointToSelect.x()];
-				pixels[i * 3 + 0] = static_cast<double>(qRed(color)) / 255.0;
-				pixels[i * 3 + 1] = static_cast<double>(qGreen(color)) / 255.0;
-				pixels[i * 3 + 2] = static_cast<double>(qBlue(color)) / 255.0;
-			}
+	m_evaluationThread = std::thread([this]() {
+		refinePreview();
+	});
+}
 
-			QRgb color = trainingOutput[y * size.width() + x];
-			std::vector<double> targetColor = { 
-				static_cast<double>(qRed(color)) / 255.0,
-				static_cast<double>(qGreen(color)) / 255.0,
-				static_cast<double>(qBlue(color)) / 255.0
-			};
-			
-			fann_train(m_network, pixels.data(), targetColor.data());
-		}
+void MainWindow::refinePreview()
+{
+	if (m_isClosing) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_evaluationMutex);
+	applyPendingNetwork();
+
+	// Training is paused, so the preview is refined to full resolution
+	if (m_previewStep != 1) {
+		preview(1);
+	}
+	lock.unlock();
+
+	QCoreApplication::postEvent(this, new EvaluationFinishedEvent());
+}
+
+void MainWindow::onSaveNetwork()
+{
+	QFileDialog dialog(this, tr("Save Network"));
+	initializeNetworkFileDialog(dialog, QFileDialog::AcceptSave);
+
+	if (dialog.exec() == QDialog::Accepted) {
+		saveNetwork(dialog.selectedFiles().first());
+	}
+}
+
+void MainWindow::onLoadNetwork()
+{
+	QFileDialog dialog(this, tr("Load Network"));
+	initializeNetworkFileDialog(dialog, QFileDialog::AcceptOpen);
+
+	if (dialog.exec() == QDialog::Accepted) {
+		loadNetwork(dialog.selectedFiles().first());
+	}
+}
+
+
+fann* MainWindow::copyNetwork(std::vector<QPoint>& kernel)
+{
+	if (m_evaluationThread.joinable()) {
+		std::unique_lock<std::mutex> lock(m_networkExchangeMutex);
+		kernel = m_publishedKernel;
+		return m_publishedNetwork != nullptr ? fann_copy(m_publishedNetwork) : nullptr;
+	}
+
+	std::unique_lock<std::mutex> lock(m_evaluationMutex);
+	kernel = m_kernel;
+	return fann_copy(m_network);
+}
+
+void MainWindow::publishNetwork()
+{
+	// Copy is made before taking the lock, which is only held for the swap
+	fann* network = fann_copy(m_network);
+	if (network == nullptr) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_networkExchangeMutex);
+	std::swap(m_publishedNetwork, network);
+	m_publishedKernel = m_kernel;
+	lock.unlock();
+
+	if (network != nullptr) {
+		fann_destroy(network);
+	}
+}
+
+void MainWindow::setNetwork(fann* network, std::vector<QPoint> kernel)
+{
+	fann_destroy(m_network);
+	m_network = network;
+	resetTrainingProgress();
+	m_isPreviewNetworkOutdated = true;
+
+	// Shown preview belongs to the previous network, so it is refined again
+	m_previewStep = MAX_PREVIEW_STEP;
+
+	if (kernel != m_kernel) {
+		m_kernel = std::move(kernel);
+		prepareTrainingData();
+		prepareInputImage();
+
+		// Cost of a pixel depends on the kernel, it is measured again
+		m_previewPixelTime = 0.0;
 	}
+
+	publishNetwork();
 }
 
-void MainWindow::preview()
+void MainWindow::applyPendingNetwork()
 {
-	if (m_inputImage == nullptr || m_resultImage == nullptr) {
+	std::unique_lock<std::mutex> lock(m_networkExchangeMutex);
+	fann* network = m_pendingNetwork;
+	std::vector<QPoint> kernel = std::move(m_pendingKernel);
+	m_pendingNetwork = nullptr;
+	lock.unlock();
+
+	if (network != nullptr) {
+		setNetwork(network, std::move(kernel));
+	}
+}
+
+void MainWindow::train()
+{
+	if (m_trainingData == nullptr) {
+		return;
+	}
+
+	fann_train_enum algorithm = static_cast<fann_train_enum>(m_trainingAlgorithm.load());
+
+	fann_set_training_algorithm(m_network, algorithm);
+	fann_set_learning_rate(m_network, m_learningRate);
+	fann_set_learning_momentum(m_network, m_learningMomentum);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	fann_train_data* data = prepareEpochData(static_cast<utils::TrainingSampler::Policy>(m_samplingPolicy.load()),
+		static_cast<utils::TrainingSampler::Order>(m_samplingOrder.load()));
+	if (data == nullptr) {
+		return;
+	}
+
+	auto prepared = std::chrono::high_resolution_clock::now();
+	float mse = fann_train_epoch(m_network, data);
+	m_isPreviewNetworkOutdated = true;
+	auto trained = std::chrono::high_resolution_clock::now();
+
+	if (mse < m_bestMse * (1.0f - CONVERGENCE_TOLERANCE)) {
+		m_bestMse = mse;
+		m_epochsWithoutImprovement = 0;
+	}
+	else {
+		++m_epochsWithoutImprovement;
+	}
+
+	printf("Epoch %u, %s, %u samples: MSE %.6f, sampled in %.1f ms, trained in %.1f ms\n", ++m_epochsCount,
+		FANN_TRAIN_NAMES[algorithm], fann_length_train_data(data), mse,
+		std::chrono::duration<double, std::milli>(prepared - start).count(),
+		std::chrono::duration<double, std::milli>(trained - prepared).count());
+}
+
+void MainWindow::preview(int step)
+{
+	if (m_paddedInputImage == nullptr || m_resultImage == nullptr) {
 		return;
 	}
 
-	const QRgb* inputImage = reinterpret_cast<const QRgb*>(m_inputImage->bits());
 	QRgb* resultImage = reinterpret_cast<QRgb*>(m_resultImage->bits());
 
 	QSize size = m_inputImage->size();
+	int width = size.width();
+	int height = size.height();
+
+	// Image is split into bands of evaluated rows, which workers take one
+	// by one, so that a slow band doesn't leave other threads waiting
+	const int bandHeight = 8 * step;
+	size_t bandsCount = (height + bandHeight - 1) / bandHeight;
+	size_t workersCount = std::min(m_previewThreadPool.getThreadsCount(), bandsCount);
+
+	// Snapshot is refreshed before timing, so it doesn't count as pixel cost
+	if (m_isPreviewNetworkOutdated || m_previewNetwork == nullptr) {
+		m_previewNetwork = std::make_unique<nn::Network<float>>(nn::importFann<float>(m_network));
+		m_previewWorkspaces.clear();
+		m_isPreviewNetworkOutdated = false;
+	}
 
-	for (int y = 0; y < size.height(); ++y) {
-		for (int x = 0; x < size.width(); ++x) {
-			QPoint point(x, y);
+	while (m_previewWorkspaces.size() < workersCount) {
+		m_previewWorkspaces.emplace_back(*m_previewNetwork);
+	}
 
-			std::vector<double> pixels(m_kernel.size() * 3);
-			for (size_t i = 0; i < m_kernel.size(); ++i) {
-				QPoint pointToSelect = point + m_kernel[i];
+	auto start = std::chrono::high_resolution_clock::now();
+	std::atomic<size_t> nextBand(0);
 
-				if (pointToSelect.x() < 0) {
-					pointToSelect.setX(0);
-				}
-				if (pointToSelect.y() < 0) {
-					pointToSelect.setY(0);
-				}
+	m_previewThreadPool.run(workersCount, [&](size_t worker) {
+		nn::Workspace<float>& workspace = m_previewWorkspaces[worker];
+		utils::PatchRowExtractor<float> extractor(*m_paddedInputImage, m_kernel);
+		size_t patchSize = extractor.getPatchSize();
 
-				if (pointToSelect.x() >= size.width()) {
-					pointToSelect.setX(size.width() - 1);
-				}
-				if (pointToSelect.y() >= size.height()) {
-					pointToSelect.setY(size.height() - 1);
+		// Evaluated pixels of a row are one batch, colors come out as bytes
+		size_t samplesCount = static_cast<size_t>((width + step - 1) / step);
+		utils::AlignedVector<float> patches(samplesCount * patchSize);
+		std::vector<uint8_t> colors(samplesCount * 3);
+
+		for (size_t band = nextBand++; band < bandsCount; band = nextBand++) {
+			int firstRow = static_cast<int>(band) * bandHeight;
+			int lastRow = std::min(firstRow + bandHeight, height);
+
+			for (int y = firstRow; y < lastRow; y += step) {
+				extractor.loadRow(y, step);
+
+				for (size_t i = 0; i < samplesCount; ++i) {
+					const float* patch = extractor.getPatch(static_cast<int>(i) * step);
+					std::copy(patch, patch + patchSize, patches.data() + i * patchSize);
 				}
 
-				QRgb color = inputImage[pointToSelect.y() * size.width() + pointToSelect.x()];
-				pixels[i * 3 + 0] = static_cast<double>(qRed(color)) / 255.0;
-				pixels[i * 3 + 1] = static_cast<double>(qGreen(color)) / 255.0;
-				pixels[i * 3 + 2] = static_cast<double>(qBlue(color)) / 255.0;
+				m_previewNetwork->evaluate(patches.data(), samplesCount, colors.data(), workspace);
+
+				int blockHeight = std::min(step, height - y);
+
+				for (size_t i = 0; i < samplesCount; ++i) {
+					int x = static_cast<int>(i) * step;
+					QRgb color = qRgb(colors[i * 3 + 0], colors[i * 3 + 1], colors[i * 3 + 2]);
+
+					int blockWidth = std::min(step, width - x);
+					for (int j = 0; j < blockHeight; ++j) {
+						std::fill_n(resultImage + (y + j) * width + x, blockWidth, color);
+					}
+				}
 			}
+		}
+	});
+
+	std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+	// Preview may run on the evaluation thread, so the label gets a copy
+	QCoreApplication::postEvent(this, new PreviewImageEvent(m_resultImage->copy()));
+
+	size_t pixelsCount = static_cast<size_t>((width + step - 1) / step) * ((height + step - 1) / step);
+
+	m_previewStep = step;
+	m_previewPixelTime = time.count() / pixelsCount;
+}
+
+int MainWindow::choosePreviewStep()
+{
+	// Cost is unknown until the first preview
+	if (m_paddedInputImage == nullptr || m_previewPixelTime == 0.0) {
+		return MAX_PREVIEW_STEP;
+	}
+
+	if (m_epochsWithoutImprovement >= CONVERGENCE_EPOCHS) {
+		return std::max(m_previewStep / 2, 1);
+	}
+
+	int step = 1;
+	while (step < MAX_PREVIEW_STEP && estimatePreviewTime(step) > PREVIEW_LATENCY_BUDGET) {
+		step *= 2;
+	}
+
+	return step;
+}
+
+double MainWindow::estimatePreviewTime(int step) const
+{
+	// Pixel time is measured by the previous preview
+	QSize size = m_inputImage->size();
+	double pixelsCount = static_cast<double>((size.width() + step - 1) / step) * ((size.height() + step - 1) / step);
+
+	return pixelsCount * m_previewPixelTime;
+}
+
+int MainWindow::schedulePreview(double trainingTime)
+{
+	int step = choosePreviewStep();
 
-			double* newColor = fann_run(m_network, pixels.data());
+	double share = m_previewShare;
+	if (share >= 1.0 || m_paddedInputImage == nullptr || m_previewPixelTime == 0.0) {
+		return step;
+	}
+
+	// Training earns preview time in proportion to the limit. Credit is
+	// capped by the wanted preview, so idle time doesn't pile up into bursts
+	double wantedTime = estimatePreviewTime(step);
+	m_previewCredit = std::min(m_previewCredit + trainingTime * share / (1.0 - share), wantedTime);
 
-			resultImage[y * size.width() + x] = qRgb(newColor[0] * 255.0, newColor[1] * 255, newColor[2] * 255);
+	for (; step <= MAX_PREVIEW_STEP; step *= 2) {
+		double time = estimatePreviewTime(step);
+		if (time <= m_previewCredit) {
+			m_previewCredit -= time;
+			return step;
 		}
 	}
 
-	m_labelRight->setPixmap(QPixmap::fromImage(*m_resultImage));
+	return 0;
+}
+
+void MainWindow::updateDutyCycle(double trainingTime, double previewTime)
+{
+	m_trainingTime = m_trainingTime * DUTY_CYCLE_DECAY + trainingTime;
+	m_previewTime = m_previewTime * DUTY_CYCLE_DECAY + previewTime;
+
+	double totalTime = m_trainingTime + m_previewTime;
+	if (totalTime <= 0.0) {
+		return;
+	}
+
+	QCoreApplication::postEvent(this, new DutyCycleEvent(m_trainingTime / totalTime));
+}
+
+void MainWindow::resetTrainingProgress()
+{
+	m_epochsCount = 0;
+	m_bestMse = std::numeric_limits<float>::infinity();
+	m_epochsWithoutImprovement = 0;
+}
+
+void MainWindow::prepareTrainingData()
+{
+	releaseTrainingData();
+
+	if (m_trainingSource == nullptr || m_trainingOutput == nullptr) {
+		return;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	m_trainingData = std::make_unique<utils::PatchDataset>(*m_trainingSource, *m_trainingOutput, m_kernel);
+	m_trainingSampler = std::make_unique<utils::TrainingSampler>(*m_trainingData,
+		static_cast<uint32_t>(m_samplingSeed.load()));
+
+	std::chrono::duration<double, std::milli> time = std::chrono::high_resolution_clock::now() - start;
+
+	printf("%zu training patches extracted in %.1f ms\n", m_trainingData->getSamplesCount(), time.count());
+
+	resetTrainingProgress();
+}
+
+void MainWindow::releaseTrainingData()
+{
+	m_trainingSampler.reset(nullptr);
+	m_trainingData.reset(nullptr);
+
+	if (m_fannTrainingData != nullptr) {
+		fann_destroy_train(m_fannTrainingData);
+		m_fannTrainingData = nullptr;
+	}
+	m_isFannTrainingDataComplete = false;
+}
+
+fann_train_data* MainWindow::prepareEpochData(utils::TrainingSampler::Policy policy,
+	utils::TrainingSampler::Order order)
+{
+	bool isComplete = policy == utils::TrainingSampler::Policy::All;
+	bool isRaster = order == utils::TrainingSampler::Order::Raster;
+
+	uint32_t seed = static_cast<uint32_t>(m_samplingSeed.load());
+	if (m_trainingSampler->getSeed() != seed) {
+		m_trainingSampler->setSeed(seed);
+	}
+
+	// Whole dataset in raster order needs no indices
+	size_t samplesCount = m_trainingData->getSamplesCount();
+	if (!isComplete || !isRaster) {
+		m_trainingSampler->select(policy, order, static_cast<size_t>(m_samplesPerEpoch.load()), m_epochSamples);
+		samplesCount = m_epochSamples.size();
+	}
+
+	// Whole dataset stays loaded between epochs
+	if (!isComplete || !m_isFannTrainingDataComplete) {
+		// Data is reused while the sample count stays the same
+		if (m_fannTrainingData != nullptr && fann_length_train_data(m_fannTrainingData) != samplesCount) {
+			fann_destroy_train(m_fannTrainingData);
+			m_fannTrainingData = nullptr;
+		}
+
+		if (m_fannTrainingData == nullptr) {
+			m_fannTrainingData = fann_create_train(static_cast<unsigned int>(samplesCount),
+				static_cast<unsigned int>(m_trainingData->getInputsCount()),
+				static_cast<unsigned int>(m_trainingData->getOutputsCount()));
+
+			if (m_fannTrainingData == nullptr) {
+				// Evaluation loop stops instead of retrying every iteration
+				m_isEvaluating = false;
+				QCoreApplication::postEvent(this, new TrainingErrorEvent(
+					QString("Not enough memory for %1 training samples.").arg(samplesCount)));
+				return nullptr;
+			}
+		}
+
+		// FANN keeps inputs and outputs of all samples in two contiguous arrays
+		fann_type* inputs = m_fannTrainingData->input[0];
+		fann_type* outputs = m_fannTrainingData->output[0];
+		if (isComplete) {
+			m_trainingData->load(static_cast<size_t>(0), samplesCount, inputs, outputs);
+		}
+		else {
+			m_trainingData->load(m_epochSamples.data(), samplesCount, inputs, outputs);
+		}
+
+		m_isFannTrainingDataComplete = isComplete;
+	}
+
+	if (!isComplete || isRaster) {
+		return m_fannTrainingData;
+	}
+
+	// Rows of the whole dataset are visited in the epoch order through
+	// row pointers, the view is never passed to fann_destroy_train
+	m_epochInputs.resize(samplesCount);
+	m_epochOutputs.resize(samplesCount);
+	for (size_t i = 0; i < samplesCount; ++i) {
+		m_epochInputs[i] = m_fannTrainingData->input[m_epochSamples[i]];
+		m_epochOutputs[i] = m_fannTrainingData->output[m_epochSamples[i]];
+	}
+
+	m_fannEpochData = *m_fannTrainingData;
+	m_fannEpochData.input = m_epochInputs.data();
+	m_fannEpochData.output = m_epochOutputs.data();
+
+	return &m_fannEpochData;
+}
+
+void MainWindow::prepareInputImage()
+{
+	if (m_inputImage == nullptr) {
+		m_paddedInputImage.reset(nullptr);
+		return;
+	}
+
+	m_paddedInputImage = std::make_unique<utils::PaddedImage>(*m_inputImage,
+		utils::PaddedImage::getKernelRadius(m_kernel));
 }
 
 void MainWindow::initializeImageFileDialog(QFileDialog & dialog, QFileDialog::AcceptMode acceptMode)
@@ -318,6 +969,152 @@ void MainWindow::initializeImageFileDialog(QFileDialog & dialog, QFileDialog::Ac
 	}
 }
 
+void MainWindow::onNetworkFileChanged(const QString& fileName)
+{
+	// File may be missing for a moment while it's replaced
+	if (!QFileInfo::exists(fileName)) {
+		return;
+	}
+
+	if (!m_networkWatcher->files().contains(fileName)) {
+		m_networkWatcher->addPath(fileName);
+	}
+
+	// Reloading own save would reset training progress
+	if (fileName == m_savedNetworkFile && QFileInfo(fileName).lastModified() == m_savedNetworkTime) {
+		return;
+	}
+
+	loadNetwork(fileName);
+}
+
+void MainWindow::saveNetwork(const QString& fileName)
+{
+	std::vector<QPoint> networkKernel;
+	fann* network = copyNetwork(networkKernel);
+
+	try {
+		if (network == nullptr) {
+			throw std::runtime_error("Not enough memory to copy network");
+		}
+
+		if (fileName.endsWith(".net", Qt::CaseInsensitive)) {
+			if (fann_save(network, fileName.toLocal8Bit().constData()) != 0) {
+				throw std::runtime_error("Can't write FANN file");
+			}
+		}
+		else {
+			std::vector<nn::KernelOffset> kernel;
+			for (auto& offset : networkKernel) {
+				kernel.push_back(nn::KernelOffset{ offset.x(), offset.y() });
+			}
+
+			nn::ModelFile::save(fileName.toLocal8Bit().constData(), nn::importFann<double>(network), kernel);
+		}
+
+		m_savedNetworkFile = QFileInfo(fileName).absoluteFilePath();
+		m_savedNetworkTime = QFileInfo(fileName).lastModified();
+
+		printf("Network saved to %s\n", fileName.toLocal8Bit().constData());
+	}
+	catch (const std::exception& e) {
+		QMessageBox::warning(this, "Error", "Cannot save network: " + QString(e.what()));
+	}
+
+	if (network != nullptr) {
+		fann_destroy(network);
+	}
+}
+
+void MainWindow::loadNetwork(const QString& fileName)
+{
+	fann* network = nullptr;
+	std::vector<QPoint> kernel;
+
+	try {
+		if (fileName.endsWith(".net", Qt::CaseInsensitive)) {
+			network = fann_create_from_file(fileName.toLocal8Bit().constData());
+			if (network == nullptr) {
+				throw std::runtime_error("Can't read FANN file");
+			}
+		}
+		else {
+			nn::ModelFile model(fileName.toLocal8Bit().constData());
+			network = nn::exportFann(model.createNetwork<double>());
+
+			for (auto& offset : model.getKernel()) {
+				kernel.push_back(QPoint(offset.x, offset.y));
+			}
+		}
+
+		// FANN files don't store kernel, it is restored from inputs count
+		size_t inputsCount = fann_get_num_input(network);
+		if (kernel.empty()) {
+			size_t sideSize = static_cast<size_t>(std::lround(std::sqrt(inputsCount / 3.0)));
+			if (sideSize % 2 == 1) {
+				kernel = generateKernel(sideSize / 2);
+			}
+		}
+
+		if (kernel.size() * 3 != inputsCount || fann_get_num_output(network) != 3) {
+			throw std::runtime_error("Network doesn't take RGB patches");
+		}
+
+		// Preview evaluates an nn snapshot, so the network must be convertible
+		nn::importFann<float>(network);
+	}
+	catch (const std::exception& e) {
+		if (network != nullptr) {
+			fann_destroy(network);
+		}
+
+		QMessageBox::warning(this, "Error", "Cannot load network: " + QString(e.what()));
+		return;
+	}
+
+	// Running evaluation thread swaps the network in before its next epoch
+	if (m_evaluationThread.joinable()) {
+		std::unique_lock<std::mutex> lock(m_networkExchangeMutex);
+
+		if (m_pendingNetwork != nullptr) {
+			fann_destroy(m_pendingNetwork);
+		}
+		m_pendingNetwork = network;
+		m_pendingKernel = std::move(kernel);
+	}
+	else {
+		std::unique_lock<std::mutex> lock(m_evaluationMutex);
+		setNetwork(network, std::move(kernel));
+		lock.unlock();
+
+		startRefinement();
+	}
+
+	if (!m_networkWatcher->files().isEmpty()) {
+		m_networkWatcher->removePaths(m_networkWatcher->files());
+	}
+	if (!m_networkWatcher->directories().isEmpty()) {
+		m_networkWatcher->removePaths(m_networkWatcher->directories());
+	}
+
+	QFileInfo fileInfo(fileName);
+	m_watchedNetworkFile = fileInfo.absoluteFilePath();
+	m_networkWatcher->addPath(m_watchedNetworkFile);
+	m_networkWatcher->addPath(fileInfo.absolutePath());
+
+	printf("Network loaded from %s\n", fileName.toLocal8Bit().constData());
+}
+
+void MainWindow::initializeNetworkFileDialog(QFileDialog& dialog, QFileDialog::AcceptMode acceptMode)
+{
+	dialog.setAcceptMode(acceptMode);
+	dialog.setNameFilters(QStringList() << "Networks (*.npnet)" << "FANN networks (*.net)");
+
+	if (acceptMode == QFileDialog::AcceptSave) {
+		dialog.setDefaultSuffix("npnet");
+	}
+}
+
 std::unique_ptr<QImage> MainWindow::loadFile(const QString & fileName)
 {
 	QImageReader reader(fileName);
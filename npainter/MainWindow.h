@@ -1,31 +1,102 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <mutex>
+#include <thread>
 
 #include <QtWidgets/qmainwindow.h>
 #include <QtWidgets/qpushbutton.h>
 #include <QtWidgets/qfiledialog.h>
 #include <QtWidgets/qlabel.h>
+#include <QtWidgets/qcombobox.h>
+#include <QtWidgets/qspinbox.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qfilesystemwatcher.h>
 
 #include <doublefann.h>
 
+#include "Network.h"
+#include "PaddedImage.h"
+#include "PatchDataset.h"
+#include "ThreadPool.h"
+#include "TrainingSampler.h"
+
 class MainWindow : public QMainWindow
 {
 public:
 	MainWindow(QWidget* parent = nullptr);
 	~MainWindow();
 
+protected:
+	// Handles events posted by the evaluation thread
+	void customEvent(QEvent* event) override;
+
 private:
 	void onSelectTrainingSource();
 	void onSelectTrainingOutput();
 	void onSelectInput();
 	void onEvaluate();
+	// Asks the evaluation thread to stop, it refines the preview before exiting
+	void stopEvaluation();
+	// Called once the evaluation thread has exited
+	void finishEvaluation();
+	// Runs the full-resolution preview on the evaluation thread without
+	// training, buttons which change its data are disabled meanwhile
+	void startRefinement();
+	// Final step of the evaluation thread, posts EvaluationFinishedEvent
+	void refinePreview();
+	void onSaveNetwork();
+	void onLoadNetwork();
+	void onNetworkFileChanged(const QString& fileName);
 
 	void train();
-	void preview();
+
+	// Evaluates every step-th pixel of every step-th row and fills step x step
+	// blocks with its color, so coarse previews show the filter at full
+	// resolution patches. Step 1 renders every pixel
+	void preview(int step);
+
+	// Finest step fitting the preview latency budget while training improves,
+	// refined one level per preview once training converges
+	int choosePreviewStep();
+	double estimatePreviewTime(int step) const;
+
+	// Keeps preview within the time limit, returns the step to render or
+	// 0 to skip the preview. Previews are made coarser before skipping
+	int schedulePreview(double trainingTime);
+	void updateDutyCycle(double trainingTime, double previewTime);
+
+	// Restarts epoch counting and convergence tracking
+	void resetTrainingProgress();
+
+	// Extracts patches of the training pair for the current kernel
+	void prepareTrainingData();
+	void releaseTrainingData();
+
+	// Converts samples of the next epoch to FANN training data,
+	// returns data to train on or nullptr without enough memory
+	fann_train_data* prepareEpochData(utils::TrainingSampler::Policy policy, utils::TrainingSampler::Order order);
+
+	// Pads input image by the current kernel radius for preview
+	void prepareInputImage();
+
+	// Networks are saved as nn model files (.npnet) or FANN files (.net)
+	void saveNetwork(const QString& fileName);
+	void loadNetwork(const QString& fileName);
+
+	// Returns copy of the current network and its kernel without waiting
+	// for an epoch. Must be released with fann_destroy, nullptr if out of memory
+	fann* copyNetwork(std::vector<QPoint>& kernel);
+	// Makes copy of the network for copyNetwork, called by the owner of m_network
+	void publishNetwork();
+	// Replaces the network, called with the evaluation mutex held
+	void setNetwork(fann* network, std::vector<QPoint> kernel);
+	// Swaps in a network loaded while the evaluation thread was running
+	void applyPendingNetwork();
 
 	void initializeImageFileDialog(QFileDialog& dialog, QFileDialog::AcceptMode acceptMode);
+	void initializeNetworkFileDialog(QFileDialog& dialog, QFileDialog::AcceptMode acceptMode);
 	std::unique_ptr<QImage> loadFile(const QString& fileName);
 	std::vector<QPoint> generateKernel(size_t size);
 
@@ -36,17 +107,100 @@ private:
 	QPushButton* m_buttonTrainingOutput;
 	QPushButton* m_buttonSource;
 	QPushButton* m_buttonEvaluate;
+	QPushButton* m_buttonSaveNetwork;
+	QPushButton* m_buttonLoadNetwork;
+
+	QComboBox* m_comboTrainingAlgorithm;
+	QDoubleSpinBox* m_spinLearningRate;
+	QDoubleSpinBox* m_spinLearningMomentum;
+	QComboBox* m_comboSamplingPolicy;
+	QSpinBox* m_spinSamplesPerEpoch;
+	QComboBox* m_comboSamplingOrder;
+	QSpinBox* m_spinSamplingSeed;
+	QDoubleSpinBox* m_spinPreviewShare;
+	QLabel* m_labelDutyCycle;
 
 	std::unique_ptr<QImage> m_trainingSource;
 	std::unique_ptr<QImage> m_trainingOutput;
+	std::unique_ptr<utils::PatchDataset> m_trainingData;
+	std::unique_ptr<utils::TrainingSampler> m_trainingSampler;
+	std::vector<uint32_t> m_epochSamples;
+
+	// Samples of the current epoch, whole dataset stays loaded
+	// between epochs when every sample is used
+	fann_train_data* m_fannTrainingData;
+	bool m_isFannTrainingDataComplete;
+
+	// Shuffled view of the whole dataset, rows point into m_fannTrainingData
+	fann_train_data m_fannEpochData;
+	std::vector<fann_type*> m_epochInputs;
+	std::vector<fann_type*> m_epochOutputs;
 
 	std::unique_ptr<QImage> m_inputImage;
+	std::unique_ptr<utils::PaddedImage> m_paddedInputImage;
 	std::unique_ptr<QImage> m_resultImage;
 
 	fann* m_network;
 	std::vector<QPoint> m_kernel;
 
+	// Training parameters are changed from UI while training runs,
+	// they are applied to the network before every epoch
+	std::atomic<int> m_trainingAlgorithm;
+	std::atomic<float> m_learningRate;
+	std::atomic<float> m_learningMomentum;
+	std::atomic<int> m_samplingPolicy;
+	std::atomic<int> m_samplesPerEpoch;
+	std::atomic<int> m_samplingOrder;
+	std::atomic<int> m_samplingSeed;
+	unsigned int m_epochsCount;
+
+	// Training is converged after several epochs without notable improvement
+	float m_bestMse;
+	unsigned int m_epochsWithoutImprovement;
+
+	// Float snapshot of the network, taken again after weights change.
+	// Preview threads evaluate rows of patches through it as batches,
+	// every thread with its own workspace
+	utils::ThreadPool m_previewThreadPool;
+	std::unique_ptr<nn::Network<float>> m_previewNetwork;
+	std::vector<nn::Workspace<float>> m_previewWorkspaces;
+	bool m_isPreviewNetworkOutdated;
+
+	// Step of the last preview and measured time of one evaluated pixel
+	int m_previewStep;
+	double m_previewPixelTime;
+
+	// Fraction of wall time preview may take, preview time earned by
+	// training and decayed sums of stage times in milliseconds
+	std::atomic<float> m_previewShare;
+	double m_previewCredit;
+	double m_trainingTime;
+	double m_previewTime;
+
+	// Reloads loaded network file when it changes on disk. Its directory
+	// is watched too, so that a replaced file is watched again
+	QFileSystemWatcher* m_networkWatcher;
+	QString m_watchedNetworkFile;
+
+	// Modification time of the last saved network, its change isn't reloaded
+	QString m_savedNetworkFile;
+	QDateTime m_savedNetworkTime;
+
+	// Networks passed between the UI and the evaluation thread, which holds
+	// the evaluation mutex for whole epochs. This mutex is held only to swap
+	// pointers. Published network is the copy made after the last epoch,
+	// pending network is loaded and waits to be swapped in before the next one
+	std::mutex m_networkExchangeMutex;
+	fann* m_publishedNetwork;
+	std::vector<QPoint> m_publishedKernel;
+	fann* m_pendingNetwork;
+	std::vector<QPoint> m_pendingKernel;
+
 	std::mutex m_evaluationMutex;
+	std::thread m_evaluationThread;
 
-	bool m_isEvaluating;
+	// Written by both the UI and the evaluation thread
+	std::atomic<bool> m_isEvaluating;
+	// Set on destruction, the evaluation thread exits without refining
+	std::atomic<bool> m_isClosing;
 };
\ No newline at end of file
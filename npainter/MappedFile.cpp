@@ -0,0 +1,97 @@
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+utils::MappedFile::MappedFile(const std::string& fileName) :
+	m_data(nullptr), m_size(0), m_file(INVALID_HANDLE_VALUE), m_mapping(nullptr)
+{
+	m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("Can't open file " + fileName);
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0) {
+		CloseHandle(m_file);
+		throw std::runtime_error("Can't map empty file " + fileName);
+	}
+	m_size = static_cast<size_t>(size.QuadPart);
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping != nullptr) {
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (m_data == nullptr) {
+		if (m_mapping != nullptr) {
+			CloseHandle(m_mapping);
+		}
+		CloseHandle(m_file);
+		throw std::runtime_error("Can't map file " + fileName);
+	}
+}
+
+utils::MappedFile::~MappedFile()
+{
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+}
+
+#else
+
+utils::MappedFile::MappedFile(const std::string& fileName) :
+	m_data(nullptr), m_size(0)
+{
+	int descriptor = open(fileName.c_str(), O_RDONLY);
+	if (descriptor < 0) {
+		throw std::runtime_error("Can't open file " + fileName);
+	}
+
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+		close(descriptor);
+		throw std::runtime_error("Can't map empty file " + fileName);
+	}
+	m_size = static_cast<size_t>(status.st_size);
+
+	// Mapping stays valid after the descriptor is closed
+	void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("Can't map file " + fileName);
+	}
+	m_data = static_cast<const uint8_t*>(data);
+}
+
+utils::MappedFile::~MappedFile()
+{
+	munmap(const_cast<uint8_t*>(m_data), m_size);
+}
+
+#endif
+
+const uint8_t* utils::MappedFile::getData() const
+{
+	return m_data;
+}
+
+size_t utils::MappedFile::getSize() const
+{
+	return m_size;
+}
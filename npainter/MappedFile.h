@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace utils
+{
+	// Read-only view of a whole file mapped into memory. Mapping
+	// starts at a page boundary, so offsets aligned in the file
+	// stay aligned in memory
+	class MappedFile
+	{
+	public:
+		// Throws std::runtime_error if file can't be opened or mapped
+		MappedFile(const std::string& fileName);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const uint8_t* getData() const;
+		size_t getSize() const;
+
+	private:
+		const uint8_t* m_data;
+		size_t m_size;
+
+#ifdef _WIN32
+		void* m_file;
+		void* m_mapping;
+#endif
+	};
+}
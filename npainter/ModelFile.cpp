@@ -0,0 +1,286 @@
+#include "ModelFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	const char MAGIC[8] = { 'N', 'P', 'N', 'N', 'M', 'O', 'D', 'L' };
+	const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	size_t alignOffset(size_t offset, size_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	template<typename T, typename Stored>
+	std::vector<T> convertValues(const uint8_t* data, size_t count)
+	{
+		const Stored* values = reinterpret_cast<const Stored*>(data);
+		return std::vector<T>(values, values + count);
+	}
+}
+
+struct nn::ModelFile::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byteOrderMark;
+	uint32_t scalarSize;
+	uint32_t inputsCount;
+	uint32_t layersCount;
+	uint32_t kernelSize;
+	uint64_t fileSize;
+	uint8_t reserved[24];
+};
+
+struct nn::ModelFile::LayerHeader
+{
+	uint32_t inputsCount;
+	uint32_t outputsCount;
+	uint32_t activationType;
+	uint32_t reserved;
+	uint64_t weightsOffset;
+	uint64_t biasesOffset;
+};
+
+const uint32_t nn::ModelFile::VERSION;
+const size_t nn::ModelFile::BLOB_ALIGNMENT;
+
+template<typename T>
+void nn::ModelFile::save(const std::string& fileName, const Network<T>& network,
+	const std::vector<KernelOffset>& kernel)
+{
+	const std::vector<Layer<T>>& layers = network.getLayers();
+
+	Header header = {};
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byteOrderMark = BYTE_ORDER_MARK;
+	header.scalarSize = sizeof(T);
+	header.inputsCount = static_cast<uint32_t>(network.getInputsCount());
+	header.layersCount = static_cast<uint32_t>(layers.size());
+	header.kernelSize = static_cast<uint32_t>(kernel.size());
+
+	// Placing blobs after all headers
+	size_t kernelOffset = sizeof(Header) + layers.size() * sizeof(LayerHeader);
+	size_t offset = kernelOffset + kernel.size() * sizeof(KernelOffset);
+
+	std::vector<LayerHeader> layerHeaders(layers.size());
+	for (size_t i = 0; i < layers.size(); ++i) {
+		LayerHeader& layerHeader = layerHeaders[i];
+		layerHeader.inputsCount = static_cast<uint32_t>(layers[i].getInputsCount());
+		layerHeader.outputsCount = static_cast<uint32_t>(layers[i].getOutputsCount());
+		layerHeader.activationType = static_cast<uint32_t>(layers[i].getActivationType());
+		layerHeader.reserved = 0;
+
+		offset = alignOffset(offset, BLOB_ALIGNMENT);
+		layerHeader.weightsOffset = offset;
+		offset += static_cast<size_t>(layerHeader.inputsCount) * layerHeader.outputsCount * sizeof(T);
+
+		offset = alignOffset(offset, BLOB_ALIGNMENT);
+		layerHeader.biasesOffset = offset;
+		offset += layerHeader.outputsCount * sizeof(T);
+	}
+
+	header.fileSize = offset;
+
+	// Assembling the whole file in memory, gaps stay zero
+	std::vector<char> buffer(offset, 0);
+	std::memcpy(buffer.data(), &header, sizeof(Header));
+	std::memcpy(buffer.data() + sizeof(Header), layerHeaders.data(), layerHeaders.size() * sizeof(LayerHeader));
+	if (!kernel.empty()) {
+		std::memcpy(buffer.data() + kernelOffset, kernel.data(), kernel.size() * sizeof(KernelOffset));
+	}
+
+	for (size_t i = 0; i < layers.size(); ++i) {
+		const LayerHeader& layerHeader = layerHeaders[i];
+
+		std::memcpy(buffer.data() + layerHeader.weightsOffset, layers[i].getWeights(),
+			static_cast<size_t>(layerHeader.inputsCount) * layerHeader.outputsCount * sizeof(T));
+		std::memcpy(buffer.data() + layerHeader.biasesOffset, layers[i].getBiases(),
+			layerHeader.outputsCount * sizeof(T));
+	}
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	file.write(buffer.data(), buffer.size());
+
+	if (!file) {
+		throw std::runtime_error("Can't write model file " + fileName);
+	}
+}
+
+nn::ModelFile::ModelFile(const std::string& fileName) :
+	m_file(fileName), m_header(reinterpret_cast<const Header*>(m_file.getData()))
+{
+	static_assert(sizeof(Header) == 64, "Model header layout changed");
+	static_assert(sizeof(LayerHeader) == 32, "Layer header layout changed");
+
+	size_t fileSize = m_file.getSize();
+
+	if (fileSize < sizeof(Header) || std::memcmp(m_header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+		throw std::runtime_error(fileName + " is not a model file");
+	}
+
+	if (m_header->version != VERSION) {
+		throw std::runtime_error("Unsupported model version in " + fileName);
+	}
+
+	if (m_header->byteOrderMark != BYTE_ORDER_MARK) {
+		throw std::runtime_error("Model " + fileName + " was saved with different byte order");
+	}
+
+	if (m_header->scalarSize != sizeof(float) && m_header->scalarSize != sizeof(double)) {
+		throw std::runtime_error("Unsupported scalar type in " + fileName);
+	}
+
+	size_t headersSize = sizeof(Header) + m_header->layersCount * sizeof(LayerHeader) +
+		m_header->kernelSize * sizeof(KernelOffset);
+
+	if (m_header->fileSize != fileSize || headersSize > fileSize || m_header->layersCount < 2) {
+		throw std::runtime_error("Model file " + fileName + " is damaged");
+	}
+
+	// Every blob must be aligned, lie inside the file and match neighbour layers
+	size_t previousOutputsCount = m_header->inputsCount;
+	for (size_t i = 0; i < m_header->layersCount; ++i) {
+		const LayerHeader& layerHeader = getLayerHeader(i);
+
+		// Weights larger than the file would also overflow their size
+		if (layerHeader.outputsCount > fileSize / m_header->scalarSize / std::max<size_t>(layerHeader.inputsCount, 1)) {
+			throw std::runtime_error("Model file " + fileName + " is damaged");
+		}
+
+		size_t weightsSize = static_cast<size_t>(layerHeader.inputsCount) * layerHeader.outputsCount * m_header->scalarSize;
+		size_t biasesSize = static_cast<size_t>(layerHeader.outputsCount) * m_header->scalarSize;
+
+		// Offsets come from the file, so sums are avoided to prevent wrapping
+		bool isValid = layerHeader.inputsCount == previousOutputsCount && layerHeader.outputsCount > 0 &&
+			layerHeader.activationType <= static_cast<uint32_t>(ActivationFunction::Type::ReLU) &&
+			layerHeader.weightsOffset % BLOB_ALIGNMENT == 0 && layerHeader.biasesOffset % BLOB_ALIGNMENT == 0 &&
+			layerHeader.weightsOffset >= headersSize && layerHeader.weightsOffset <= fileSize &&
+			weightsSize <= fileSize - layerHeader.weightsOffset &&
+			layerHeader.biasesOffset >= headersSize && layerHeader.biasesOffset <= fileSize &&
+			biasesSize <= fileSize - layerHeader.biasesOffset;
+
+		if (!isValid) {
+			throw std::runtime_error("Model file " + fileName + " is damaged");
+		}
+
+		previousOutputsCount = layerHeader.outputsCount;
+	}
+}
+
+size_t nn::ModelFile::getScalarSize() const
+{
+	return m_header->scalarSize;
+}
+
+size_t nn::ModelFile::getInputsCount() const
+{
+	return m_header->inputsCount;
+}
+
+size_t nn::ModelFile::getLayersCount() const
+{
+	return m_header->layersCount;
+}
+
+size_t nn::ModelFile::getLayerInputsCount(size_t layer) const
+{
+	return getLayerHeader(layer).inputsCount;
+}
+
+size_t nn::ModelFile::getLayerOutputsCount(size_t layer) const
+{
+	return getLayerHeader(layer).outputsCount;
+}
+
+nn::ActivationFunction::Type nn::ModelFile::getActivationType(size_t layer) const
+{
+	return static_cast<ActivationFunction::Type>(getLayerHeader(layer).activationType);
+}
+
+template<typename T>
+const T* nn::ModelFile::getWeights(size_t layer) const
+{
+	checkScalarType<T>();
+	return reinterpret_cast<const T*>(m_file.getData() + getLayerHeader(layer).weightsOffset);
+}
+
+template<typename T>
+const T* nn::ModelFile::getBiases(size_t layer) const
+{
+	checkScalarType<T>();
+	return reinterpret_cast<const T*>(m_file.getData() + getLayerHeader(layer).biasesOffset);
+}
+
+std::vector<nn::KernelOffset> nn::ModelFile::getKernel() const
+{
+	const KernelOffset* kernel = reinterpret_cast<const KernelOffset*>(m_file.getData() +
+		sizeof(Header) + m_header->layersCount * sizeof(LayerHeader));
+
+	return std::vector<KernelOffset>(kernel, kernel + m_header->kernelSize);
+}
+
+template<typename T>
+nn::Network<T> nn::ModelFile::createNetwork() const
+{
+	std::vector<Layer<T>> layers;
+	layers.reserve(m_header->layersCount);
+
+	for (size_t i = 0; i < m_header->layersCount; ++i) {
+		const LayerHeader& layerHeader = getLayerHeader(i);
+		ActivationFunction::Type activationType = getActivationType(i);
+
+		if (m_header->scalarSize == sizeof(T)) {
+			layers.emplace_back(layerHeader.inputsCount, layerHeader.outputsCount, activationType,
+				getWeights<T>(i), getBiases<T>(i));
+			continue;
+		}
+
+		size_t weightsCount = static_cast<size_t>(layerHeader.inputsCount) * layerHeader.outputsCount;
+		const uint8_t* data = m_file.getData();
+
+		std::vector<T> weights = m_header->scalarSize == sizeof(float) ?
+			convertValues<T, float>(data + layerHeader.weightsOffset, weightsCount) :
+			convertValues<T, double>(data + layerHeader.weightsOffset, weightsCount);
+		std::vector<T> biases = m_header->scalarSize == sizeof(float) ?
+			convertValues<T, float>(data + layerHeader.biasesOffset, layerHeader.outputsCount) :
+			convertValues<T, double>(data + layerHeader.biasesOffset, layerHeader.outputsCount);
+
+		layers.emplace_back(layerHeader.inputsCount, layerHeader.outputsCount, activationType,
+			weights.data(), biases.data());
+	}
+
+	return Network<T>(m_header->inputsCount, layers);
+}
+
+const nn::ModelFile::LayerHeader& nn::ModelFile::getLayerHeader(size_t layer) const
+{
+	const LayerHeader* layers = reinterpret_cast<const LayerHeader*>(m_file.getData() + sizeof(Header));
+	return layers[layer];
+}
+
+template<typename T>
+void nn::ModelFile::checkScalarType() const
+{
+	if (m_header->scalarSize != sizeof(T)) {
+		throw std::runtime_error("Model scalar type doesn't match");
+	}
+}
+
+template void nn::ModelFile::save(const std::string& fileName, const Network<float>& network,
+	const std::vector<KernelOffset>& kernel);
+template void nn::ModelFile::save(const std::string& fileName, const Network<double>& network,
+	const std::vector<KernelOffset>& kernel);
+
+template const float* nn::ModelFile::getWeights(size_t layer) const;
+template const double* nn::ModelFile::getWeights(size_t layer) const;
+template const float* nn::ModelFile::getBiases(size_t layer) const;
+template const double* nn::ModelFile::getBiases(size_t layer) const;
+
+template nn::Network<float> nn::ModelFile::createNetwork() const;
+template nn::Network<double> nn::ModelFile::createNetwork() const;
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Network.h"
+
+namespace nn
+{
+	// Position of a patch pixel relative to the filtered one
+	struct KernelOffset
+	{
+		int32_t x;
+		int32_t y;
+	};
+
+	// Versioned binary model. File starts with a fixed header, followed
+	// by a header for every layer and kernel offsets. Weights and biases
+	// of every layer follow as separate 64-byte aligned blobs in the
+	// in-memory layout of Layer, so the mapped file is used in place
+	// without any parsing. Numbers are stored in native byte order
+	class ModelFile
+	{
+	public:
+		static const uint32_t VERSION = 1;
+		static const size_t BLOB_ALIGNMENT = 64;
+
+		template<typename T>
+		static void save(const std::string& fileName, const Network<T>& network,
+			const std::vector<KernelOffset>& kernel);
+
+		// Maps the file and validates its headers, throws
+		// std::runtime_error if it isn't a supported model
+		ModelFile(const std::string& fileName);
+
+		// 4 for float and 8 for double models
+		size_t getScalarSize() const;
+		size_t getInputsCount() const;
+		size_t getLayersCount() const;
+
+		size_t getLayerInputsCount(size_t layer) const;
+		size_t getLayerOutputsCount(size_t layer) const;
+		ActivationFunction::Type getActivationType(size_t layer) const;
+
+		// Pointers into the mapped file, valid while the model is alive.
+		// T must match the scalar size of the file
+		template<typename T>
+		const T* getWeights(size_t layer) const;
+		template<typename T>
+		const T* getBiases(size_t layer) const;
+
+		std::vector<KernelOffset> getKernel() const;
+
+		// Copies parameters into a new network, converting them to T if needed
+		template<typename T>
+		Network<T> createNetwork() const;
+
+	private:
+		struct Header;
+		struct LayerHeader;
+
+		const LayerHeader& getLayerHeader(size_t layer) const;
+
+		template<typename T>
+		void checkScalarType() const;
+
+		utils::MappedFile m_file;
+		const Header* m_header;
+	};
+}
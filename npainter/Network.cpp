@@ -1,7 +1,14 @@
 #include "Network.h"
 
-nn::Network::Network(const std::vector<size_t>& topology) :
-	m_recentAverageError(0.0)
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+template<typename T>
+nn::Network<T>::Network(const std::vector<size_t>& topology) :
+	m_threadPool(nullptr), m_trainingMode(TrainingMode::Synchronous), m_updatesCount(0), m_recentAverageError(T(0))
 {
 	size_t layersCount = topology.size();
 
@@ -15,98 +22,442 @@ nn::Network::Network(const std::vector<size_t>& topology) :
 	else {
 		throw std::runtime_error("Network must contain input and output layers, and at least one hidden");
 	}
-	
-	std::shared_ptr<ActivationFunction> identityActivation = std::make_shared<IdentityActivationFunction>();
-	std::shared_ptr<ActivationFunction> sigmoidActivation = std::make_shared<SigmoidActivationFunction>();
 
-	m_inputLayer = std::vector<Neuron>(topology[0], Neuron(topology[0], identityActivation));
+	// Input layer only passes values through, so it has no weights
+	m_inputsCount = topology[0];
 
-	m_hiddenLayers.resize(layersCount - 2);
-	for (size_t i = 0; i < m_hiddenLayers.size(); ++i) {
-		m_hiddenLayers[i] = std::vector<Neuron>(topology[i + 1], Neuron(topology[i], sigmoidActivation));
+	m_layers.reserve(layersCount - 1);
+	for (size_t i = 1; i < layersCount; ++i) {
+		m_layers.emplace_back(topology[i - 1], topology[i], ActivationFunction::Type::Sigmoid);
 	}
 
-	m_outputLayer = std::vector<Neuron>(topology.back(), Neuron(topology[layersCount - 2], sigmoidActivation));
+	prepareWorkers(1);
 }
 
-std::vector<double> nn::Network::evaluate(const std::vector<double>& inputs)
+template<typename T>
+nn::Network<T>::Network(size_t inputsCount, const std::vector<Layer<T>>& layers) :
+	m_inputsCount(inputsCount), m_layers(layers),
+	m_threadPool(nullptr), m_trainingMode(TrainingMode::Synchronous), m_updatesCount(0), m_recentAverageError(T(0))
 {
-	for (size_t i = 0; i < inputs.size(); ++i) {
-		m_inputLayer[i].feedForward(inputs);
+	if (m_layers.size() < 2) {
+		throw std::runtime_error("Network must contain input and output layers, and at least one hidden");
 	}
 
-	std::vector<Neuron>* previousLayer = &m_inputLayer;
-	for (size_t i = 0; i < m_hiddenLayers.size(); ++i) {
-		std::vector<Neuron>& currentLayer = m_hiddenLayers[i];
-		for (size_t j = 0; j < currentLayer.size(); ++j) {
-			currentLayer[j].feedForward(*previousLayer);
+	size_t previousOutputsCount = inputsCount;
+	for (auto& layer : m_layers) {
+		if (layer.getInputsCount() != previousOutputsCount || layer.getOutputsCount() == 0) {
+			throw std::runtime_error("Layers don't match each other");
 		}
-		previousLayer = &currentLayer;
+		previousOutputsCount = layer.getOutputsCount();
 	}
 
-	std::vector<double> result(m_outputLayer.size());
+	prepareWorkers(1);
+}
 
-	for (size_t i = 0; i < m_outputLayer.size(); ++i) {
-		m_outputLayer[i].feedForward(*previousLayer);
-		result[i] = m_outputLayer[i].getValue();
+template<typename T>
+std::vector<T> nn::Network<T>::evaluate(const std::vector<T>& inputs)
+{
+	if (inputs.size() != m_inputsCount) {
+		throw std::runtime_error("Inputs strange layout");
 	}
 
+	std::vector<T> result(m_layers.back().getOutputsCount());
+	evaluate(inputs.data(), result.data(), m_workers[0]);
+
 	return result;
 }
 
-void nn::Network::train(const std::vector<double>& inputs, const std::vector<double>& targets)
+template<typename T>
+void nn::Network<T>::evaluate(const T* inputs, size_t batch, T* outputs)
 {
-	if (m_outputLayer.size() != targets.size()) {
+	evaluate(inputs, batch, outputs, m_workers[0]);
+}
+
+template<typename T>
+void nn::Network<T>::evaluate(const T* inputs, T* outputs, Workspace<T>& workspace) const
+{
+	const T* previousValues = inputs;
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		m_layers[i].feedForward(previousValues, workspace.getValues(i));
+		previousValues = workspace.getValues(i);
+	}
+
+	std::copy(previousValues, previousValues + m_layers.back().getOutputsCount(), outputs);
+}
+
+template<typename T>
+void nn::Network<T>::evaluate(const T* inputs, size_t batch, T* outputs, Workspace<T>& workspace) const
+{
+	const size_t blockCapacity = Workspace<T>::BATCH_BLOCK_SIZE;
+	size_t outputsCount = m_layers.back().getOutputsCount();
+
+	for (size_t first = 0; first < batch; first += blockCapacity) {
+		size_t blockSize = std::min(blockCapacity, batch - first);
+
+		T* layerOutputs;
+		T* layerInputs = feedForwardHidden(inputs + first * m_inputsCount, blockSize, workspace, layerOutputs);
+		m_layers.back().feedForward(layerInputs, blockSize, layerOutputs);
+
+		// Transposing results back
+		T* blockOutputs = outputs + first * outputsCount;
+		for (size_t k = 0; k < blockSize; ++k) {
+			for (size_t j = 0; j < outputsCount; ++j) {
+				blockOutputs[k * outputsCount + j] = layerOutputs[j * blockSize + k];
+			}
+		}
+	}
+}
+
+template<typename T>
+void nn::Network<T>::evaluate(const T* inputs, size_t batch, uint8_t* outputs)
+{
+	evaluate(inputs, batch, outputs, m_workers[0]);
+}
+
+template<typename T>
+void nn::Network<T>::evaluate(const T* inputs, size_t batch, uint8_t* outputs, Workspace<T>& workspace) const
+{
+	const size_t blockCapacity = Workspace<T>::BATCH_BLOCK_SIZE;
+	size_t outputsCount = m_layers.back().getOutputsCount();
+
+	for (size_t first = 0; first < batch; first += blockCapacity) {
+		size_t blockSize = std::min(blockCapacity, batch - first);
+
+		// Output layer writes bytes already in sample-major layout
+		T* sums;
+		T* layerInputs = feedForwardHidden(inputs + first * m_inputsCount, blockSize, workspace, sums);
+		m_layers.back().feedForward(layerInputs, blockSize, sums, outputs + first * outputsCount);
+	}
+}
+
+template<typename T>
+void nn::Network<T>::train(const std::vector<T>& inputs, const std::vector<T>& targets)
+{
+	if (inputs.size() != m_inputsCount) {
+		throw std::runtime_error("Inputs strange layout");
+	}
+
+	if (m_layers.back().getOutputsCount() != targets.size()) {
 		throw std::runtime_error("Targets layout is strange");
 	}
 
-	std::vector<double> result = evaluate(inputs);
+	train(inputs.data(), targets.data(), 1);
+}
 
-	// calculating error
-	double error = 0.0;
-	for (size_t i = 0; i < result.size(); ++i) {
-		error += targets[i] - result[i];
+template<typename T>
+void nn::Network<T>::train(const T* inputs, const T* targets, size_t batch)
+{
+	if (batch == 0) {
+		return;
 	}
-	error = sqrt((error * error) / result.size());
 
-	double recentAverageSmoothingFactor = 100.0;
-	m_recentAverageError = (m_recentAverageError * recentAverageSmoothingFactor + error) / (recentAverageSmoothingFactor + 1.0);
+	size_t outputsCount = m_layers.back().getOutputsCount();
 
-	// Calculating output gradients
-	for (size_t i = 0; i < m_outputLayer.size(); ++i) {
-		Neuron& neuron = m_outputLayer[i];
-		double delta = targets[i] - neuron.m_value;
-		neuron.m_gradient = delta * neuron.m_activationFunction->derivative(neuron.m_value);
+	size_t workersCount = 1;
+	if (m_threadPool != nullptr) {
+		workersCount = std::min(m_threadPool->getThreadsCount(), batch);
 	}
 
-	// Calculating hiddent layers gradients
-	std::vector<Neuron>* nextLayer = &m_outputLayer;
-	for (size_t i = 0; i < m_hiddenLayers.size(); ++i) {
-		std::vector<Neuron>& currentLayer = m_hiddenLayers[m_hiddenLayers.size() - 1 - i];
+	prepareWorkers(workersCount);
+
+	bool isHogwild = m_trainingMode == TrainingMode::Hogwild && workersCount > 1;
+
+	// Hogwild workers take update steps concurrently
+	std::atomic<size_t> nextStep(m_updatesCount + 1);
 
-		for (size_t j = 0; j < currentLayer.size(); ++j) {
-			Neuron& neuron = currentLayer[j];
+	// Each worker gets a contiguous part of the batch
+	auto processPart = [&](size_t index) {
+		Workspace<T>& worker = m_workers[index];
 
-			double dow = 0.0;
-			for (size_t k = 0; k < nextLayer->size(); ++k) {
-				dow += (*nextLayer)[k].m_gradient * (*nextLayer)[k].m_inputConnections[j].getWeight();
+		size_t first = batch * index / workersCount;
+		size_t last = batch * (index + 1) / workersCount;
+
+		for (size_t k = first; k < last; ++k) {
+			trainSample(worker, inputs + k * m_inputsCount, targets + k * outputsCount);
+
+			if (isHogwild) {
+				updateWeights(worker, 1, nextStep++);
 			}
+		}
+	};
+
+	if (workersCount == 1) {
+		processPart(0);
+	}
+	else {
+		m_threadPool->run(workersCount, processPart);
+	}
+
+	T errorSum = T(0);
+	for (size_t i = 0; i < workersCount; ++i) {
+		errorSum += m_workers[i].m_errorSum;
+		m_workers[i].m_errorSum = T(0);
+	}
+	updateRecentAverageError(errorSum, batch);
+
+	if (isHogwild) {
+		m_updatesCount = nextStep - 1;
+		return;
+	}
+
+	// Tree reduction, on each level worker i takes sums of worker i + stride
+	for (size_t stride = 1; stride < workersCount; stride *= 2) {
+		size_t pairsCount = (workersCount - stride + 2 * stride - 1) / (2 * stride);
+
+		m_threadPool->run(pairsCount, [&](size_t pair) {
+			size_t destination = pair * 2 * stride;
+			reduceGradients(m_workers[destination], m_workers[destination + stride]);
+		});
+	}
+
+	updateWeights(m_workers[0], batch, ++m_updatesCount);
+}
+
+template<typename T>
+void nn::Network<T>::train(const T* inputs, const T* targets, size_t batch, Workspace<T>& workspace)
+{
+	if (batch == 0) {
+		return;
+	}
+
+	size_t outputsCount = m_layers.back().getOutputsCount();
+
+	for (size_t k = 0; k < batch; ++k) {
+		trainSample(workspace, inputs + k * m_inputsCount, targets + k * outputsCount);
+	}
+
+	updateRecentAverageError(workspace.m_errorSum, batch);
+	workspace.m_errorSum = T(0);
+
+	updateWeights(workspace, batch, ++m_updatesCount);
+}
+
+template<typename T>
+T nn::Network<T>::getRecentAverageError() const
+{
+	return m_recentAverageError;
+}
+
+template<typename T>
+void nn::Network<T>::setThreadPool(utils::ThreadPool* threadPool)
+{
+	m_threadPool = threadPool;
+}
+
+template<typename T>
+void nn::Network<T>::setTrainingMode(TrainingMode trainingMode)
+{
+	m_trainingMode = trainingMode;
+}
+
+template<typename T>
+void nn::Network<T>::setOptimizer(const Optimizer& optimizer)
+{
+	m_optimizer = optimizer;
+	m_updatesCount = 0;
 
-			neuron.m_gradient = dow * neuron.m_activationFunction->derivative(neuron.m_value);
+	for (auto& layer : m_layers) {
+		layer.resetOptimizerState(m_optimizer);
+	}
+}
+
+template<typename T>
+const nn::Optimizer& nn::Network<T>::getOptimizer() const
+{
+	return m_optimizer;
+}
+
+template<typename T>
+T nn::Network<T>::prune(T sparsity, PruningMode mode)
+{
+	if (sparsity < T(0) || sparsity > T(1)) {
+		throw std::runtime_error("Sparsity must be in [0, 1]");
+	}
+
+	// Threshold is the magnitude at the given quantile, weights below it are pruned
+	auto findThreshold = [sparsity](std::vector<T>& magnitudes) {
+		size_t index = static_cast<size_t>(sparsity * magnitudes.size());
+		if (index >= magnitudes.size()) {
+			return std::numeric_limits<T>::infinity();
+		}
+
+		std::nth_element(magnitudes.begin(), magnitudes.begin() + index, magnitudes.end());
+		return magnitudes[index];
+	};
+
+	auto collectMagnitudes = [](const Layer<T>& layer, std::vector<T>& magnitudes) {
+		const T* weights = layer.getWeights();
+		size_t weightsCount = layer.getInputsCount() * layer.getOutputsCount();
+
+		for (size_t i = 0; i < weightsCount; ++i) {
+			magnitudes.push_back(std::abs(weights[i]));
+		}
+	};
+
+	std::vector<T> magnitudes;
+	T globalThreshold = T(0);
+
+	if (mode == PruningMode::Global) {
+		for (auto& layer : m_layers) {
+			collectMagnitudes(layer, magnitudes);
+		}
+		globalThreshold = findThreshold(magnitudes);
+	}
+
+	size_t weightsCount = 0;
+	size_t zerosCount = 0;
+
+	for (auto& layer : m_layers) {
+		T threshold = globalThreshold;
+
+		if (mode == PruningMode::PerLayer) {
+			magnitudes.clear();
+			collectMagnitudes(layer, magnitudes);
+			threshold = findThreshold(magnitudes);
+		}
+
+		zerosCount += layer.prune(threshold);
+		weightsCount += layer.getInputsCount() * layer.getOutputsCount();
+	}
+
+	return static_cast<T>(zerosCount) / static_cast<T>(weightsCount);
+}
+
+template<typename T>
+void nn::Network<T>::setActivationPrecision(Precision precision)
+{
+	for (auto& layer : m_layers) {
+		layer.setActivationPrecision(precision);
+	}
+}
+
+template<typename T>
+size_t nn::Network<T>::getInputsCount() const
+{
+	return m_inputsCount;
+}
+
+template<typename T>
+const std::vector<nn::Layer<T>>& nn::Network<T>::getLayers() const
+{
+	return m_layers;
+}
+
+template<typename T>
+void nn::Network<T>::prepareWorkers(size_t workersCount)
+{
+	while (m_workers.size() < workersCount) {
+		m_workers.emplace_back(*this);
+	}
+}
+
+template<typename T>
+T* nn::Network<T>::feedForwardHidden(const T* inputs, size_t blockSize, Workspace<T>& workspace, T*& freeBuffer) const
+{
+	T* layerInputs = workspace.getBatchInputs();
+	T* layerOutputs = workspace.getBatchOutputs();
+
+	// Transposing samples to feature-major layout
+	for (size_t k = 0; k < blockSize; ++k) {
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			layerInputs[j * blockSize + k] = inputs[k * m_inputsCount + j];
 		}
+	}
+
+	for (size_t i = 0; i + 1 < m_layers.size(); ++i) {
+		m_layers[i].feedForward(layerInputs, blockSize, layerOutputs);
+		std::swap(layerInputs, layerOutputs);
+	}
+
+	freeBuffer = layerOutputs;
+	return layerInputs;
+}
+
+template<typename T>
+void nn::Network<T>::trainSample(Workspace<T>& worker, const T* inputs, const T* targets) const
+{
+	size_t lastLayer = m_layers.size() - 1;
+	size_t outputsCount = m_layers[lastLayer].getOutputsCount();
+
+	// Keeping sums and values of every layer for the backward pass
+	const T* previousValues = inputs;
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		m_layers[i].feedForward(previousValues, worker.getSums(i), worker.getValues(i));
+		previousValues = worker.getValues(i);
+	}
+
+	// Calculating error and output gradients
+	const T* outputs = worker.getValues(lastLayer);
+	T* outputGradients = worker.getGradients(lastLayer);
+
+	T error = T(0);
+	for (size_t i = 0; i < outputsCount; ++i) {
+		outputGradients[i] = targets[i] - outputs[i];
+		error += outputGradients[i] * outputGradients[i];
+	}
+	worker.m_errorSum += std::sqrt(error / outputsCount);
+
+	m_layers[lastLayer].applyDerivative(worker.getSums(lastLayer), outputs, outputGradients);
 
-		nextLayer = &currentLayer;
+	// Calculating hidden layers gradients
+	for (size_t i = lastLayer; i > 0; --i) {
+		m_layers[i].backPropagate(worker.getGradients(i), worker.getGradients(i - 1));
+		m_layers[i - 1].applyDerivative(worker.getSums(i - 1), worker.getValues(i - 1), worker.getGradients(i - 1));
 	}
 
-	// Calculating input layer gradients
-	for (size_t i = 0; i < m_inputLayer.size(); ++i) {
-		Neuron& neuron = m_inputLayer[i];
+	// Accumulating weight gradients, each layer uses values of the previous one
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		const T* layerInputs = i == 0 ? inputs : worker.getValues(i - 1);
+		m_layers[i].accumulateGradients(layerInputs, worker.getGradients(i),
+			worker.getWeightGradients(i), worker.getBiasGradients(i));
+	}
+}
+
+template<typename T>
+void nn::Network<T>::updateWeights(Workspace<T>& worker, size_t batch, size_t step)
+{
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		m_layers[i].updateWeights(m_optimizer, worker.getWeightGradients(i), worker.getBiasGradients(i), batch, step);
+	}
+
+	worker.clearGradients();
+}
+
+template<typename T>
+void nn::Network<T>::reduceGradients(Workspace<T>& destination, Workspace<T>& source) const
+{
+	// Moves gradient sums of the source worker into the destination
+	for (size_t i = 0; i < m_layers.size(); ++i) {
+		T* weightGradients = destination.getWeightGradients(i);
+		T* sourceWeightGradients = source.getWeightGradients(i);
 
-		double dow = 0.0;
-		for (size_t j = 0; j < nextLayer->size(); ++j) {
-			dow += (*nextLayer)[j].m_gradient * (*nextLayer)[j].m_inputConnections[i].getWeight();
+		size_t weightsCount = m_layers[i].getInputsCount() * m_layers[i].getOutputsCount();
+		for (size_t j = 0; j < weightsCount; ++j) {
+			weightGradients[j] += sourceWeightGradients[j];
+			sourceWeightGradients[j] = T(0);
 		}
 
-		neuron.m_gradient = dow * neuron.m_activationFunction->derivative(neuron.m_value);
+		T* biasGradients = destination.getBiasGradients(i);
+		T* sourceBiasGradients = source.getBiasGradients(i);
+
+		size_t biasesCount = m_layers[i].getOutputsCount();
+		for (size_t j = 0; j < biasesCount; ++j) {
+			biasGradients[j] += sourceBiasGradients[j];
+			sourceBiasGradients[j] = T(0);
+		}
 	}
 }
+
+template<typename T>
+void nn::Network<T>::updateRecentAverageError(T errorSum, size_t batch)
+{
+	// Same as smoothing every sample error with factor 100,
+	// assuming that all samples of the batch have mean error
+	T recentAverageSmoothingFactor = T(100);
+	T decay = std::pow(recentAverageSmoothingFactor / (recentAverageSmoothingFactor + T(1)), static_cast<T>(batch));
+
+	m_recentAverageError = m_recentAverageError * decay + (errorSum / batch) * (T(1) - decay);
+}
+
+template class nn::Network<float>;
+template class nn::Network<double>;
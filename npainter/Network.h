@@ -2,22 +2,110 @@
 
 #include <vector>
 
-#include "Neuron.h"
+#include "Layer.h"
+#include "ThreadPool.h"
+#include "Workspace.h"
 
 namespace nn
 {
+	template<typename T>
 	class Network
 	{
 	public:
+		enum class TrainingMode
+		{
+			// Workers accumulate private gradients, which are summed
+			// before a single weight update per batch
+			Synchronous,
+			// Workers update shared weights after every sample without
+			// any locking. Faster on many cores, but not deterministic.
+			// Only valid with Optimizer::Type::SgdMomentum, Adam and Rprop
+			// state is updated with the same races and Rprop needs batches
+			Hogwild
+		};
+
+		enum class PruningMode
+		{
+			// One magnitude threshold for weights of all layers
+			Global,
+			// Every layer loses the same fraction of its weights
+			PerLayer
+		};
+
 		Network(const std::vector<size_t>& topology);
+		// Creates network from trained layers, each layer must take
+		// outputs of the previous one
+		Network(size_t inputsCount, const std::vector<Layer<T>>& layers);
+
+		std::vector<T> evaluate(const std::vector<T>& inputs);
+		void evaluate(const T* inputs, size_t batch, T* outputs);
+
+		// Allocation-free overloads, all intermediate values are kept
+		// in the workspace, which can be reused between calls
+		void evaluate(const T* inputs, T* outputs, Workspace<T>& workspace) const;
+		void evaluate(const T* inputs, size_t batch, T* outputs, Workspace<T>& workspace) const;
+
+		// Outputs quantized to bytes, round(255 * y) per output. Sigmoid and
+		// tanh output layers map pre-activations with a threshold search,
+		// so the output function is never evaluated
+		void evaluate(const T* inputs, size_t batch, uint8_t* outputs);
+		void evaluate(const T* inputs, size_t batch, uint8_t* outputs, Workspace<T>& workspace) const;
+
+		void train(const std::vector<T>& inputs, const std::vector<T>& targets);
+		// Accumulates gradients over the batch and updates weights once
+		void train(const T* inputs, const T* targets, size_t batch);
+		// Same as above, but always single-threaded and using the workspace
+		void train(const T* inputs, const T* targets, size_t batch, Workspace<T>& workspace);
+
+		T getRecentAverageError() const;
+
+		// Splits training batches between pool threads. Pool is not
+		// owned by the network and must outlive it, nullptr disables
+		// multithreading
+		void setThreadPool(utils::ThreadPool* threadPool);
+		void setTrainingMode(TrainingMode trainingMode);
+
+		// Replaces the weight update rule and resets its state
+		void setOptimizer(const Optimizer& optimizer);
+		const Optimizer& getOptimizer() const;
+
+		// Zeroes the given fraction of weights with the smallest magnitudes,
+		// biases are kept. Pruned weights stay zero if training continues,
+		// so a few fine-tuning epochs can recover the accuracy. Returns
+		// fraction of zero weights after pruning
+		T prune(T sparsity, PruningMode mode);
+
+		// Selects accuracy of activation functions in forward pass
+		void setActivationPrecision(Precision precision);
+
+		size_t getInputsCount() const;
+		const std::vector<Layer<T>>& getLayers() const;
 
-		std::vector<double> evaluate(const std::vector<double>& inputs);
-		void train(const std::vector<double>& inputs, const std::vector<double>& targets);
 	private:
-		std::vector<Neuron> m_inputLayer;
-		std::vector<std::vector<Neuron>> m_hiddenLayers;
-		std::vector<Neuron> m_outputLayer;
+		void prepareWorkers(size_t workersCount);
+
+		// Transposes block of samples into feature-major layout and runs all layers
+		// except the output one. Returns buffer with inputs of the output layer,
+		// the other batch buffer is returned through freeBuffer
+		T* feedForwardHidden(const T* inputs, size_t blockSize, Workspace<T>& workspace, T*& freeBuffer) const;
+
+		void trainSample(Workspace<T>& worker, const T* inputs, const T* targets) const;
+		void updateWeights(Workspace<T>& worker, size_t batch, size_t step);
+		void reduceGradients(Workspace<T>& destination, Workspace<T>& source) const;
+		void updateRecentAverageError(T errorSum, size_t batch);
+
+		size_t m_inputsCount;
+		std::vector<Layer<T>> m_layers;
+
+		// Workspaces of internal training threads, the first one is
+		// also used by overloads without explicit workspace
+		std::vector<Workspace<T>> m_workers;
+		utils::ThreadPool* m_threadPool;
+		TrainingMode m_trainingMode;
+		Optimizer m_optimizer;
+		// Weight updates since the optimizer was set, Adam step counter
+		size_t m_updatesCount;
 
-		double m_recentAverageError;
+		T m_recentAverageError;
 	};
-}
\ No newline at end of file
+}
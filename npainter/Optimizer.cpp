@@ -0,0 +1,192 @@
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SimdOps.h"
+
+namespace
+{
+	// Calls kernel(Ops(), i) for every vector of values, using
+	// the widest available operations and scalar ones for the tail
+	template<typename T, typename Kernel>
+	void forEachValue(size_t count, Kernel kernel)
+	{
+		using Ops = typename nn::simd::VectorOps<T>::Type;
+
+		size_t i = 0;
+		for (; i + Ops::WIDTH <= count; i += Ops::WIDTH) {
+			kernel(Ops(), i);
+		}
+
+		for (; i < count; ++i) {
+			kernel(nn::simd::ScalarOps<T>(), i);
+		}
+	}
+}
+
+const size_t nn::Optimizer::STATE_SIZE;
+
+const double nn::Optimizer::ADAM_BETA1 = 0.9;
+const double nn::Optimizer::ADAM_BETA2 = 0.999;
+const double nn::Optimizer::ADAM_EPSILON = 1e-8;
+
+// Same as FANN defaults
+const double nn::Optimizer::RPROP_INCREASE_FACTOR = 1.2;
+const double nn::Optimizer::RPROP_DECREASE_FACTOR = 0.5;
+const double nn::Optimizer::RPROP_MIN_STEP = 0.0;
+const double nn::Optimizer::RPROP_MAX_STEP = 50.0;
+
+nn::Optimizer::Optimizer(Type type) :
+	m_type(type), m_momentum(0.0)
+{
+	switch (type) {
+	case Type::SgdMomentum:
+		m_learningRate = 0.15;
+		m_momentum = 0.5;
+		break;
+
+	case Type::Adam:
+		m_learningRate = 0.001;
+		break;
+
+	case Type::Rprop:
+		m_learningRate = 0.1;
+		break;
+	}
+}
+
+nn::Optimizer::Type nn::Optimizer::getType() const
+{
+	return m_type;
+}
+
+void nn::Optimizer::setLearningRate(double learningRate)
+{
+	m_learningRate = learningRate;
+}
+
+double nn::Optimizer::getLearningRate() const
+{
+	return m_learningRate;
+}
+
+void nn::Optimizer::setMomentum(double momentum)
+{
+	m_momentum = momentum;
+}
+
+double nn::Optimizer::getMomentum() const
+{
+	return m_momentum;
+}
+
+template<typename T>
+void nn::Optimizer::resetState(T* state, size_t count) const
+{
+	std::fill(state, state + STATE_SIZE * count, T(0));
+
+	// Rprop keeps step sizes in the second plane
+	if (m_type == Type::Rprop) {
+		std::fill(state + count, state + 2 * count, static_cast<T>(m_learningRate));
+	}
+}
+
+template<typename T>
+void nn::Optimizer::update(T* parameters, const T* gradients, T* state, size_t count, T gradientScale, size_t step) const
+{
+	switch (m_type) {
+	case Type::SgdMomentum: {
+		T* deltas = state;
+
+		const T rate = static_cast<T>(m_learningRate) * gradientScale;
+		const T momentum = static_cast<T>(m_momentum);
+
+		forEachValue<T>(count, [&](auto ops, size_t i) {
+			using Ops = decltype(ops);
+
+			auto delta = Ops::add(Ops::mul(Ops::set(rate), Ops::load(gradients + i)),
+				Ops::mul(Ops::set(momentum), Ops::load(deltas + i)));
+
+			Ops::store(deltas + i, delta);
+			Ops::store(parameters + i, Ops::add(Ops::load(parameters + i), delta));
+		});
+		break;
+	}
+
+	case Type::Adam: {
+		T* moments = state;
+		T* squaredMoments = state + count;
+
+		const T beta1 = static_cast<T>(ADAM_BETA1);
+		const T beta2 = static_cast<T>(ADAM_BETA2);
+		const T epsilon = static_cast<T>(ADAM_EPSILON);
+
+		// Bias correction is folded into the rate
+		double correction1 = 1.0 - std::pow(ADAM_BETA1, static_cast<double>(step));
+		double correction2 = 1.0 - std::pow(ADAM_BETA2, static_cast<double>(step));
+		const T rate = static_cast<T>(m_learningRate * std::sqrt(correction2) / correction1);
+
+		forEachValue<T>(count, [&](auto ops, size_t i) {
+			using Ops = decltype(ops);
+
+			auto gradient = Ops::mul(Ops::load(gradients + i), Ops::set(gradientScale));
+
+			auto moment = Ops::add(Ops::mul(Ops::set(beta1), Ops::load(moments + i)),
+				Ops::mul(Ops::set(T(1) - beta1), gradient));
+			auto squaredMoment = Ops::add(Ops::mul(Ops::set(beta2), Ops::load(squaredMoments + i)),
+				Ops::mul(Ops::set(T(1) - beta2), Ops::mul(gradient, gradient)));
+
+			Ops::store(moments + i, moment);
+			Ops::store(squaredMoments + i, squaredMoment);
+
+			auto delta = Ops::div(Ops::mul(Ops::set(rate), moment), Ops::add(Ops::sqrt(squaredMoment), Ops::set(epsilon)));
+			Ops::store(parameters + i, Ops::add(Ops::load(parameters + i), delta));
+		});
+		break;
+	}
+
+	case Type::Rprop: {
+		T* previousGradients = state;
+		T* steps = state + count;
+
+		const T increaseFactor = static_cast<T>(RPROP_INCREASE_FACTOR);
+		const T decreaseFactor = static_cast<T>(RPROP_DECREASE_FACTOR);
+		const T minStep = static_cast<T>(RPROP_MIN_STEP);
+		const T maxStep = static_cast<T>(RPROP_MAX_STEP);
+
+		// iRPROP-: after a sign change the step shrinks and the gradient
+		// is forgotten, so the next update doesn't shrink it again
+		forEachValue<T>(count, [&](auto ops, size_t i) {
+			using Ops = decltype(ops);
+
+			auto zero = Ops::set(T(0));
+			auto gradient = Ops::load(gradients + i);
+			auto product = Ops::mul(gradient, Ops::load(previousGradients + i));
+
+			auto grows = Ops::greater(product, zero);
+			auto shrinks = Ops::less(product, zero);
+
+			auto factor = Ops::select(grows, Ops::set(increaseFactor),
+				Ops::select(shrinks, Ops::set(decreaseFactor), Ops::set(T(1))));
+			auto stepSize = Ops::min(Ops::max(Ops::mul(Ops::load(steps + i), factor), Ops::set(minStep)), Ops::set(maxStep));
+
+			gradient = Ops::select(shrinks, zero, gradient);
+
+			auto delta = Ops::select(Ops::greater(gradient, zero), stepSize,
+				Ops::select(Ops::less(gradient, zero), Ops::sub(zero, stepSize), zero));
+
+			Ops::store(steps + i, stepSize);
+			Ops::store(previousGradients + i, gradient);
+			Ops::store(parameters + i, Ops::add(Ops::load(parameters + i), delta));
+		});
+		break;
+	}
+	}
+}
+
+template void nn::Optimizer::resetState(float* state, size_t count) const;
+template void nn::Optimizer::resetState(double* state, size_t count) const;
+
+template void nn::Optimizer::update(float* parameters, const float* gradients, float* state, size_t count, float gradientScale, size_t step) const;
+template void nn::Optimizer::update(double* parameters, const double* gradients, double* state, size_t count, double gradientScale, size_t step) const;
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+namespace nn
+{
+	// Rule of applying batch gradients to parameters. Every rule is one
+	// fused SSE2/AVX2 pass over a contiguous parameter buffer, its
+	// gradients and its state. Gradients point to the descent direction,
+	// as they are accumulated from (target - output) errors
+	class Optimizer
+	{
+	public:
+		enum class Type
+		{
+			// Learning rate with classic momentum
+			SgdMomentum,
+			// Adaptive moments, learning rate is the largest step
+			Adam,
+			// Batch iRPROP-, learning rate is the initial step. Uses only
+			// gradient signs, so batches should be large
+			Rprop
+		};
+
+		// Number of state values kept for each parameter
+		static const size_t STATE_SIZE = 2;
+
+		// Creates optimizer with default settings of the type
+		Optimizer(Type type = Type::SgdMomentum);
+
+		Type getType() const;
+
+		void setLearningRate(double learningRate);
+		double getLearningRate() const;
+
+		// Used only by SgdMomentum
+		void setMomentum(double momentum);
+		double getMomentum() const;
+
+		// State holds STATE_SIZE planes of count values
+		template<typename T>
+		void resetState(T* state, size_t count) const;
+
+		// Gradients are multiplied by gradientScale before use. Step is
+		// the number of the update starting from 1, used by Adam
+		template<typename T>
+		void update(T* parameters, const T* gradients, T* state, size_t count, T gradientScale, size_t step) const;
+
+	private:
+		Type m_type;
+
+		double m_learningRate;
+		double m_momentum;
+
+		static const double ADAM_BETA1;
+		static const double ADAM_BETA2;
+		static const double ADAM_EPSILON;
+
+		static const double RPROP_INCREASE_FACTOR;
+		static const double RPROP_DECREASE_FACTOR;
+		static const double RPROP_MIN_STEP;
+		static const double RPROP_MAX_STEP;
+	};
+}
@@ -0,0 +1,162 @@
+#include "PaddedImage.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace
+{
+	// Maps coordinate outside of [0, size) to the source one, -1 means black
+	int mapCoordinate(int coordinate, int size, utils::PaddedImage::BorderMode borderMode)
+	{
+		if (coordinate >= 0 && coordinate < size) {
+			return coordinate;
+		}
+
+		switch (borderMode) {
+		case utils::PaddedImage::BorderMode::Mirror:
+		{
+			if (size == 1) {
+				return 0;
+			}
+
+			// Reflection is periodic, so borders wider than image are also covered
+			int period = 2 * (size - 1);
+			coordinate = std::abs(coordinate) % period;
+			return coordinate < size ? coordinate : period - coordinate;
+		}
+
+		case utils::PaddedImage::BorderMode::Zero:
+			return -1;
+
+		default:
+			return std::min(std::max(coordinate, 0), size - 1);
+		}
+	}
+}
+
+utils::PaddedImage::PaddedImage(const QImage& image, size_t padding, BorderMode borderMode) :
+	m_width(image.width()), m_height(image.height()), m_padding(padding), m_stride(image.width() + 2 * padding)
+{
+	// Lines of 32-bit images have no alignment gaps
+	QImage source = image.convertToFormat(QImage::Format_RGB32);
+	initialize(reinterpret_cast<const QRgb*>(source.constBits()), borderMode);
+}
+
+utils::PaddedImage::PaddedImage(const QRgb* pixels, int width, int height, size_t padding, BorderMode borderMode) :
+	m_width(width), m_height(height), m_padding(padding), m_stride(width + 2 * padding)
+{
+	initialize(pixels, borderMode);
+}
+
+int utils::PaddedImage::getWidth() const
+{
+	return m_width;
+}
+
+int utils::PaddedImage::getHeight() const
+{
+	return m_height;
+}
+
+size_t utils::PaddedImage::getPadding() const
+{
+	return m_padding;
+}
+
+const QRgb* utils::PaddedImage::getRow(int y) const
+{
+	return getCenter(0, y);
+}
+
+std::vector<ptrdiff_t> utils::PaddedImage::getKernelOffsets(const std::vector<QPoint>& kernel) const
+{
+	if (getKernelRadius(kernel) > m_padding) {
+		throw std::runtime_error("Kernel is larger than image padding");
+	}
+
+	std::vector<ptrdiff_t> offsets;
+	offsets.reserve(kernel.size());
+
+	for (auto& offset : kernel) {
+		offsets.push_back(static_cast<ptrdiff_t>(offset.y()) * static_cast<ptrdiff_t>(m_stride) + offset.x());
+	}
+
+	return offsets;
+}
+
+void utils::PaddedImage::gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, uint8_t* bytes) const
+{
+	const QRgb* center = getCenter(x, y);
+
+	for (size_t i = 0; i < offsets.size(); ++i) {
+		QRgb color = center[offsets[i]];
+		bytes[i * 3 + 0] = static_cast<uint8_t>(qRed(color));
+		bytes[i * 3 + 1] = static_cast<uint8_t>(qGreen(color));
+		bytes[i * 3 + 2] = static_cast<uint8_t>(qBlue(color));
+	}
+}
+
+template<typename T>
+void utils::PaddedImage::gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, T* values) const
+{
+	const QRgb* center = getCenter(x, y);
+
+	for (size_t i = 0; i < offsets.size(); ++i) {
+		QRgb color = center[offsets[i]];
+		values[i * 3 + 0] = static_cast<T>(qRed(color)) / T(255);
+		values[i * 3 + 1] = static_cast<T>(qGreen(color)) / T(255);
+		values[i * 3 + 2] = static_cast<T>(qBlue(color)) / T(255);
+	}
+}
+
+size_t utils::PaddedImage::getKernelRadius(const std::vector<QPoint>& kernel)
+{
+	size_t radius = 0;
+	for (auto& offset : kernel) {
+		radius = std::max(radius, static_cast<size_t>(std::max(std::abs(offset.x()), std::abs(offset.y()))));
+	}
+
+	return radius;
+}
+
+void utils::PaddedImage::initialize(const QRgb* pixels, BorderMode borderMode)
+{
+	if (m_width <= 0 || m_height <= 0) {
+		throw std::runtime_error("Image is empty");
+	}
+
+	int border = static_cast<int>(m_padding);
+	size_t paddedHeight = m_height + 2 * m_padding;
+
+	m_pixels.resize(m_stride * paddedHeight);
+
+	// Source index of every padded column is computed once
+	std::vector<int> columns(m_stride);
+	for (size_t x = 0; x < m_stride; ++x) {
+		columns[x] = mapCoordinate(static_cast<int>(x) - border, m_width, borderMode);
+	}
+
+	for (size_t y = 0; y < paddedHeight; ++y) {
+		int sourceY = mapCoordinate(static_cast<int>(y) - border, m_height, borderMode);
+		QRgb* row = m_pixels.data() + y * m_stride;
+
+		if (sourceY < 0) {
+			std::fill(row, row + m_stride, qRgb(0, 0, 0));
+			continue;
+		}
+
+		const QRgb* sourceRow = pixels + static_cast<size_t>(sourceY) * m_width;
+		for (size_t x = 0; x < m_stride; ++x) {
+			row[x] = columns[x] < 0 ? qRgb(0, 0, 0) : sourceRow[columns[x]];
+		}
+	}
+}
+
+const QRgb* utils::PaddedImage::getCenter(int x, int y) const
+{
+	return m_pixels.data() + (y + m_padding) * m_stride + x + m_padding;
+}
+
+template void utils::PaddedImage::gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, float* values) const;
+template void utils::PaddedImage::gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, double* values) const;
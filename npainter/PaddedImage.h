@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QtCore/qpoint.h>
+#include <QtGui/qimage.h>
+
+namespace utils
+{
+	// RGB32 image copy surrounded by a border of the given width. Every
+	// pixel of a patch which doesn't go further than the border is read at
+	// a fixed offset from the center pixel, so gathering has no branches
+	class PaddedImage
+	{
+	public:
+		enum class BorderMode
+		{
+			// Border repeats the nearest edge pixel
+			Replicate,
+			// Border reflects the image without repeating the edge pixel
+			Mirror,
+			// Border is black
+			Zero
+		};
+
+		PaddedImage(const QImage& image, size_t padding, BorderMode borderMode = BorderMode::Replicate);
+		PaddedImage(const QRgb* pixels, int width, int height, size_t padding,
+			BorderMode borderMode = BorderMode::Replicate);
+
+		int getWidth() const;
+		int getHeight() const;
+		size_t getPadding() const;
+
+		// Pixel (0, y), pixels of the row can be indexed from -padding to
+		// width + padding - 1 and y can go beyond the image by padding
+		const QRgb* getRow(int y) const;
+
+		// Offsets of kernel pixels from the center pixel in the padded buffer.
+		// Kernel offsets must not exceed padding
+		std::vector<ptrdiff_t> getKernelOffsets(const std::vector<QPoint>& kernel) const;
+
+		// Writes RGB values of the patch around (x, y) in kernel order,
+		// either as bytes or as values in [0, 1]
+		void gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, uint8_t* bytes) const;
+		template<typename T>
+		void gatherPatch(int x, int y, const std::vector<ptrdiff_t>& offsets, T* values) const;
+
+		// Largest absolute coordinate of kernel offsets
+		static size_t getKernelRadius(const std::vector<QPoint>& kernel);
+
+	private:
+		void initialize(const QRgb* pixels, BorderMode borderMode);
+		const QRgb* getCenter(int x, int y) const;
+
+		int m_width;
+		int m_height;
+		size_t m_padding;
+		size_t m_stride;
+
+		std::vector<QRgb> m_pixels;
+	};
+}
@@ -0,0 +1,183 @@
+#include "PatchDataset.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "PatchRowExtractor.h"
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define NPAINTER_SSE2
+#endif
+
+namespace
+{
+#ifdef NPAINTER_SSE2
+	// Zero extends 16 bytes to four vectors of 32-bit integers
+	void unpackBytes(const uint8_t* bytes, __m128i* integers)
+	{
+		const __m128i zero = _mm_setzero_si128();
+
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes));
+		__m128i low = _mm_unpacklo_epi8(packed, zero);
+		__m128i high = _mm_unpackhi_epi8(packed, zero);
+
+		integers[0] = _mm_unpacklo_epi16(low, zero);
+		integers[1] = _mm_unpackhi_epi16(low, zero);
+		integers[2] = _mm_unpacklo_epi16(high, zero);
+		integers[3] = _mm_unpackhi_epi16(high, zero);
+	}
+
+	// Division instead of multiplication by reciprocal keeps values
+	// equal to the ones computed by scalar code
+	size_t widenVector(const uint8_t* bytes, size_t count, float* values)
+	{
+		const __m128 scale = _mm_set1_ps(255.0f);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i integers[4];
+			unpackBytes(bytes + i, integers);
+
+			for (size_t j = 0; j < 4; ++j) {
+				_mm_storeu_ps(values + i + j * 4, _mm_div_ps(_mm_cvtepi32_ps(integers[j]), scale));
+			}
+		}
+
+		return i;
+	}
+
+	size_t widenVector(const uint8_t* bytes, size_t count, double* values)
+	{
+		const __m128d scale = _mm_set1_pd(255.0);
+
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16) {
+			__m128i integers[4];
+			unpackBytes(bytes + i, integers);
+
+			for (size_t j = 0; j < 4; ++j) {
+				__m128i upper = _mm_shuffle_epi32(integers[j], _MM_SHUFFLE(1, 0, 3, 2));
+				_mm_storeu_pd(values + i + j * 4, _mm_div_pd(_mm_cvtepi32_pd(integers[j]), scale));
+				_mm_storeu_pd(values + i + j * 4 + 2, _mm_div_pd(_mm_cvtepi32_pd(upper), scale));
+			}
+		}
+
+		return i;
+	}
+#else
+	template<typename T>
+	size_t widenVector(const uint8_t* bytes, size_t count, T* values)
+	{
+		return 0;
+	}
+#endif
+}
+
+template<typename T>
+void utils::widenBytes(const uint8_t* bytes, size_t count, T* values)
+{
+	for (size_t i = widenVector(bytes, count, values); i < count; ++i) {
+		values[i] = static_cast<T>(bytes[i]) / T(255);
+	}
+}
+
+const size_t utils::PatchDataset::CHANNELS_COUNT;
+
+utils::PatchDataset::PatchDataset(const QImage& source, const QImage& output, const std::vector<QPoint>& kernel,
+	PaddedImage::BorderMode borderMode) :
+	m_kernel(kernel), m_width(source.width()), m_height(source.height()), m_samplesCount(0), m_inputsCount(kernel.size() * CHANNELS_COUNT)
+{
+	if (source.size() != output.size()) {
+		throw std::runtime_error("Filter source and output must have the same size");
+	}
+
+	PaddedImage sourceImage(source, PaddedImage::getKernelRadius(m_kernel), borderMode);
+	PatchRowExtractor<uint8_t> extractor(sourceImage, m_kernel);
+
+	// Pixels are read as 0xffRRGGBB words
+	QImage outputImage = output.convertToFormat(QImage::Format_RGB32);
+
+	int width = m_width;
+	int height = m_height;
+
+	m_samplesCount = static_cast<size_t>(width) * height;
+	m_inputs.resize(m_samplesCount * m_inputsCount);
+	m_targets.resize(m_samplesCount * CHANNELS_COUNT);
+
+	uint8_t* inputs = m_inputs.data();
+	uint8_t* targets = m_targets.data();
+
+	for (int y = 0; y < height; ++y) {
+		const QRgb* outputRow = reinterpret_cast<const QRgb*>(outputImage.constScanLine(y));
+
+		extractor.gatherRow(y, inputs);
+		inputs += width * m_inputsCount;
+
+		for (int x = 0; x < width; ++x) {
+			QRgb color = outputRow[x];
+			*targets++ = static_cast<uint8_t>(qRed(color));
+			*targets++ = static_cast<uint8_t>(qGreen(color));
+			*targets++ = static_cast<uint8_t>(qBlue(color));
+		}
+	}
+}
+
+size_t utils::PatchDataset::getSamplesCount() const
+{
+	return m_samplesCount;
+}
+
+int utils::PatchDataset::getWidth() const
+{
+	return m_width;
+}
+
+int utils::PatchDataset::getHeight() const
+{
+	return m_height;
+}
+
+size_t utils::PatchDataset::getInputsCount() const
+{
+	return m_inputsCount;
+}
+
+size_t utils::PatchDataset::getOutputsCount() const
+{
+	return CHANNELS_COUNT;
+}
+
+const std::vector<QPoint>& utils::PatchDataset::getKernel() const
+{
+	return m_kernel;
+}
+
+const uint8_t* utils::PatchDataset::getInputs(size_t sample) const
+{
+	return m_inputs.data() + sample * m_inputsCount;
+}
+
+template<typename T>
+void utils::PatchDataset::load(size_t first, size_t count, T* inputs, T* targets) const
+{
+	widenBytes(m_inputs.data() + first * m_inputsCount, count * m_inputsCount, inputs);
+	widenBytes(m_targets.data() + first * CHANNELS_COUNT, count * CHANNELS_COUNT, targets);
+}
+
+template<typename T>
+void utils::PatchDataset::load(const uint32_t* indices, size_t count, T* inputs, T* targets) const
+{
+	for (size_t i = 0; i < count; ++i) {
+		widenBytes(m_inputs.data() + indices[i] * m_inputsCount, m_inputsCount, inputs + i * m_inputsCount);
+		widenBytes(m_targets.data() + indices[i] * CHANNELS_COUNT, CHANNELS_COUNT, targets + i * CHANNELS_COUNT);
+	}
+}
+
+template void utils::widenBytes(const uint8_t* bytes, size_t count, float* values);
+template void utils::widenBytes(const uint8_t* bytes, size_t count, double* values);
+
+template void utils::PatchDataset::load(size_t first, size_t count, float* inputs, float* targets) const;
+template void utils::PatchDataset::load(size_t first, size_t count, double* inputs, double* targets) const;
+template void utils::PatchDataset::load(const uint32_t* indices, size_t count, float* inputs, float* targets) const;
+template void utils::PatchDataset::load(const uint32_t* indices, size_t count, double* inputs, double* targets) const;
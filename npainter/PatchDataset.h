@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QtCore/qpoint.h>
+#include <QtGui/qimage.h>
+
+#include "AlignedAllocator.h"
+#include "PaddedImage.h"
+
+namespace utils
+{
+	// Converts bytes to values in [0, 1], widening 16 bytes at a time with SSE2
+	template<typename T>
+	void widenBytes(const uint8_t* bytes, size_t count, T* values);
+
+	// Training patches of a filter pair, extracted once. Every sample keeps
+	// RGB bytes of the kernel pixels around a source pixel, pixels outside
+	// of the image come from the border mode, and the target stores RGB bytes
+	// of the output pixel. Epochs only stream these buffers and widen them
+	class PatchDataset
+	{
+	public:
+		static const size_t CHANNELS_COUNT = 3;
+
+		PatchDataset(const QImage& source, const QImage& output, const std::vector<QPoint>& kernel,
+			PaddedImage::BorderMode borderMode = PaddedImage::BorderMode::Replicate);
+
+		// Samples follow source pixels in raster order
+		size_t getSamplesCount() const;
+		int getWidth() const;
+		int getHeight() const;
+		size_t getInputsCount() const;
+		size_t getOutputsCount() const;
+
+		const std::vector<QPoint>& getKernel() const;
+
+		// Input bytes of a sample
+		const uint8_t* getInputs(size_t sample) const;
+
+		// Samples [first, first + count), sample-major like fann_train expects
+		template<typename T>
+		void load(size_t first, size_t count, T* inputs, T* targets) const;
+
+		// Samples from the list of indices, in the same layout
+		template<typename T>
+		void load(const uint32_t* indices, size_t count, T* inputs, T* targets) const;
+
+	private:
+		std::vector<QPoint> m_kernel;
+
+		int m_width;
+		int m_height;
+		size_t m_samplesCount;
+		size_t m_inputsCount;
+
+		utils::AlignedVector<uint8_t> m_inputs;
+		utils::AlignedVector<uint8_t> m_targets;
+	};
+}
@@ -0,0 +1,143 @@
+#include "PatchRowExtractor.h"
+
+#include <algorithm>
+
+namespace
+{
+	template<typename T>
+	T convertByte(size_t byte)
+	{
+		return static_cast<T>(byte) / T(255);
+	}
+
+	template<>
+	uint8_t convertByte<uint8_t>(size_t byte)
+	{
+		return static_cast<uint8_t>(byte);
+	}
+}
+
+template<typename T>
+utils::PatchRowExtractor<T>::PatchRowExtractor(const PaddedImage& image, const std::vector<QPoint>& kernel) :
+	m_image(image), m_kernel(kernel), m_offsets(image.getKernelOffsets(kernel)),
+	m_isColumnKernel(isColumnKernel(kernel)), m_radius(PaddedImage::getKernelRadius(kernel)),
+	m_columnSize((2 * m_radius + 1) * 3), m_patchSize(kernel.size() * 3)
+{
+	for (size_t i = 0; i < 256; ++i) {
+		m_values[i] = convertByte<T>(i);
+	}
+
+	size_t width = static_cast<size_t>(image.getWidth());
+	m_buffer.resize(m_isColumnKernel ? (width + 2 * m_radius) * m_columnSize : width * m_patchSize);
+}
+
+template<typename T>
+bool utils::PatchRowExtractor<T>::isColumnKernel(const std::vector<QPoint>& kernel)
+{
+	int radius = static_cast<int>(PaddedImage::getKernelRadius(kernel));
+	int side = 2 * radius + 1;
+
+	if (kernel.size() != static_cast<size_t>(side * side)) {
+		return false;
+	}
+
+	for (int i = 0; i < side; ++i) {
+		for (int j = 0; j < side; ++j) {
+			if (kernel[i * side + j] != QPoint(i - radius, j - radius)) {
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+template<typename T>
+size_t utils::PatchRowExtractor<T>::getPatchSize() const
+{
+	return m_patchSize;
+}
+
+template<typename T>
+void utils::PatchRowExtractor<T>::loadRow(int y, int step)
+{
+	int width = m_image.getWidth();
+
+	if (!m_isColumnKernel) {
+		for (int x = 0; x < width; x += step) {
+			const QRgb* center = m_image.getRow(y) + x;
+			T* patch = m_buffer.data() + x * m_patchSize;
+
+			for (size_t i = 0; i < m_offsets.size(); ++i) {
+				QRgb color = center[m_offsets[i]];
+				patch[i * 3 + 0] = m_values[qRed(color)];
+				patch[i * 3 + 1] = m_values[qGreen(color)];
+				patch[i * 3 + 2] = m_values[qBlue(color)];
+			}
+		}
+		return;
+	}
+
+	int radius = static_cast<int>(m_radius);
+	int side = 2 * radius + 1;
+
+	// Rows of the column, from top to bottom
+	const QRgb* rows[64];
+	std::vector<const QRgb*> largeRows;
+	const QRgb** columnRows = rows;
+	if (side > 64) {
+		largeRows.resize(side);
+		columnRows = largeRows.data();
+	}
+
+	for (int j = 0; j < side; ++j) {
+		columnRows[j] = m_image.getRow(y + j - radius);
+	}
+
+	// Patch of pixel x spans stored columns x..x + 2 * radius. With a step
+	// wider than the patch, columns between patches are skipped
+	int converted = 0;
+	for (int x = 0; x < width; x += step) {
+		int end = x + side;
+		for (int i = std::max(x, converted); i < end; ++i) {
+			T* column = m_buffer.data() + i * m_columnSize;
+			int sourceX = i - radius;
+
+			for (int j = 0; j < side; ++j) {
+				QRgb color = columnRows[j][sourceX];
+				column[j * 3 + 0] = m_values[qRed(color)];
+				column[j * 3 + 1] = m_values[qGreen(color)];
+				column[j * 3 + 2] = m_values[qBlue(color)];
+			}
+		}
+		converted = end;
+	}
+}
+
+template<typename T>
+const T* utils::PatchRowExtractor<T>::getPatch(int x) const
+{
+	// Column of pixel x - radius is stored at index x
+	return m_buffer.data() + x * (m_isColumnKernel ? m_columnSize : m_patchSize);
+}
+
+template<typename T>
+void utils::PatchRowExtractor<T>::gatherRow(int y, T* patches)
+{
+	loadRow(y);
+
+	int width = m_image.getWidth();
+	if (!m_isColumnKernel) {
+		std::copy(m_buffer.data(), m_buffer.data() + width * m_patchSize, patches);
+		return;
+	}
+
+	for (int x = 0; x < width; ++x) {
+		const T* patch = getPatch(x);
+		std::copy(patch, patch + m_patchSize, patches + x * m_patchSize);
+	}
+}
+
+template class utils::PatchRowExtractor<uint8_t>;
+template class utils::PatchRowExtractor<float>;
+template class utils::PatchRowExtractor<double>;
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "AlignedAllocator.h"
+#include "PaddedImage.h"
+
+namespace utils
+{
+	// Extracts patches of a whole image row at once. Square kernels made by
+	// MainWindow::generateKernel list pixels column by column, so a patch is
+	// `side` consecutive kernel columns. Each column of the row is converted
+	// once into a buffer, where the patch of pixel x is a contiguous slice
+	// starting at column x. Cost per pixel is one column instead of the
+	// whole patch. Other kernels are gathered pixel by pixel.
+	// T is uint8_t for raw bytes, float or double for values in [0, 1]
+	template<typename T>
+	class PatchRowExtractor
+	{
+	public:
+		PatchRowExtractor(const PaddedImage& image, const std::vector<QPoint>& kernel);
+
+		// Whether kernel is square and lists pixels column by column
+		static bool isColumnKernel(const std::vector<QPoint>& kernel);
+
+		size_t getPatchSize() const;
+
+		// Prepares patches of row y at x = 0, step, 2 * step... Other patches
+		// are left stale. Patch pointers stay valid until the next call
+		void loadRow(int y, int step = 1);
+		const T* getPatch(int x) const;
+
+		// Loads the row and copies its patches to sample-major batch
+		void gatherRow(int y, T* patches);
+
+	private:
+		const PaddedImage& m_image;
+		std::vector<QPoint> m_kernel;
+		std::vector<ptrdiff_t> m_offsets;
+
+		bool m_isColumnKernel;
+		size_t m_radius;
+		size_t m_columnSize;
+		size_t m_patchSize;
+
+		// Converted value of every byte
+		T m_values[256];
+
+		// Columns of the padded row for column kernels, patches otherwise
+		utils::AlignedVector<T> m_buffer;
+	};
+}
@@ -0,0 +1,269 @@
+#include "QuantizedNetwork.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define NPAINTER_SSE2
+#endif
+
+namespace
+{
+	// Dot product of unsigned values and signed weights, count must be
+	// a multiple of 16 and both arrays must be 16 bytes aligned. Bytes are
+	// widened to 16 bits and multiplied with pmaddwd, which sums pairs of
+	// products into 32-bit lanes without saturation
+	int32_t dot(const uint8_t* values, const int8_t* weights, size_t count)
+	{
+#if defined(__AVX2__)
+		__m256i sum = _mm256_setzero_si256();
+
+		for (size_t i = 0; i < count; i += 16) {
+			__m256i a = _mm256_cvtepu8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(values + i)));
+			__m256i b = _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(weights + i)));
+			sum = _mm256_add_epi32(sum, _mm256_madd_epi16(a, b));
+		}
+
+		__m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+#elif defined(NPAINTER_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		__m128i half = zero;
+
+		for (size_t i = 0; i < count; i += 16) {
+			__m128i a = _mm_load_si128(reinterpret_cast<const __m128i*>(values + i));
+			__m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(weights + i));
+
+			// Zero extending values and sign extending weights
+			__m128i aLow = _mm_unpacklo_epi8(a, zero);
+			__m128i aHigh = _mm_unpackhi_epi8(a, zero);
+			__m128i bLow = _mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8);
+			__m128i bHigh = _mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8);
+
+			half = _mm_add_epi32(half, _mm_madd_epi16(aLow, bLow));
+			half = _mm_add_epi32(half, _mm_madd_epi16(aHigh, bHigh));
+		}
+#endif
+
+#ifdef NPAINTER_SSE2
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+		half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(half);
+#else
+		int32_t sum = 0;
+		for (size_t i = 0; i < count; ++i) {
+			sum += static_cast<int32_t>(values[i]) * static_cast<int32_t>(weights[i]);
+		}
+		return sum;
+#endif
+	}
+
+	size_t alignCount(size_t count, size_t alignment)
+	{
+		return (count + alignment - 1) / alignment * alignment;
+	}
+
+	uint8_t toByte(double value)
+	{
+		return static_cast<uint8_t>(std::lround(std::min(std::max(value, 0.0), 1.0) * 255.0));
+	}
+}
+
+const size_t nn::QuantizedNetwork::INPUTS_ALIGNMENT;
+const size_t nn::QuantizedNetwork::BATCH_BLOCK_SIZE;
+
+template<typename T>
+nn::QuantizedNetwork::QuantizedNetwork(const Network<T>& network, const T* calibrationInputs, size_t calibrationCount) :
+	m_inputsCount(network.getInputsCount())
+{
+	if (calibrationCount == 0) {
+		throw std::runtime_error("Quantization needs at least one calibration sample");
+	}
+
+	const std::vector<Layer<T>>& layers = network.getLayers();
+	size_t lastLayer = layers.size() - 1;
+
+	// Calibrating ranges of hidden layer values
+	std::vector<double> minValues(layers.size(), std::numeric_limits<double>::max());
+	std::vector<double> maxValues(layers.size(), std::numeric_limits<double>::lowest());
+
+	Workspace<T> workspace(network);
+	std::vector<T> outputs(layers.back().getOutputsCount());
+
+	for (size_t k = 0; k < calibrationCount; ++k) {
+		network.evaluate(calibrationInputs + k * m_inputsCount, outputs.data(), workspace);
+
+		for (size_t l = 0; l < lastLayer; ++l) {
+			const T* values = workspace.getValues(l);
+
+			for (size_t i = 0; i < layers[l].getOutputsCount(); ++i) {
+				minValues[l] = std::min(minValues[l], static_cast<double>(values[i]));
+				maxValues[l] = std::max(maxValues[l], static_cast<double>(values[i]));
+			}
+		}
+	}
+
+	// Network inputs and outputs are always bytes of [0, 1]
+	minValues[lastLayer] = 0.0;
+	maxValues[lastLayer] = 1.0;
+
+	// Converting layers
+	double inputScale = 1.0 / 255.0;
+	int32_t inputZeroPoint = 0;
+	size_t maxStride = 0;
+
+	m_layers.resize(layers.size());
+	for (size_t l = 0; l < layers.size(); ++l) {
+		const Layer<T>& layer = layers[l];
+		QuantizedLayer& quantizedLayer = m_layers[l];
+
+		quantizedLayer.inputsCount = layer.getInputsCount();
+		quantizedLayer.outputsCount = layer.getOutputsCount();
+		quantizedLayer.inputsStride = alignCount(quantizedLayer.inputsCount, INPUTS_ALIGNMENT);
+		quantizedLayer.activationType = layer.getActivationType();
+		quantizedLayer.activationPrecision = layer.getActivationPrecision();
+
+		size_t weightsCount = quantizedLayer.inputsCount * quantizedLayer.outputsCount;
+
+		double maxWeight = 0.0;
+		for (size_t i = 0; i < weightsCount; ++i) {
+			maxWeight = std::max(maxWeight, std::abs(static_cast<double>(layer.getWeights()[i])));
+		}
+
+		double weightScale = maxWeight > 0.0 ? maxWeight / 127.0 : 1.0;
+		quantizedLayer.multiplier = static_cast<float>(weightScale * inputScale);
+
+		quantizedLayer.weights.assign(quantizedLayer.outputsCount * quantizedLayer.inputsStride, 0);
+		quantizedLayer.offsets.resize(quantizedLayer.outputsCount);
+
+		for (size_t i = 0; i < quantizedLayer.outputsCount; ++i) {
+			const T* row = layer.getWeights() + i * quantizedLayer.inputsCount;
+			int8_t* quantizedRow = quantizedLayer.weights.data() + i * quantizedLayer.inputsStride;
+
+			int32_t rowSum = 0;
+			for (size_t j = 0; j < quantizedLayer.inputsCount; ++j) {
+				quantizedRow[j] = static_cast<int8_t>(std::lround(row[j] / weightScale));
+				rowSum += quantizedRow[j];
+			}
+
+			// Zero point of inputs is subtracted from the sum here
+			quantizedLayer.offsets[i] = static_cast<float>(layer.getBiases()[i] -
+				weightScale * inputScale * inputZeroPoint * rowSum);
+		}
+
+		double range = maxValues[l] - minValues[l];
+		double outputScale = range > 0.0 ? range / 255.0 : 1.0 / 255.0;
+
+		quantizedLayer.outputScale = static_cast<float>(outputScale);
+		quantizedLayer.outputZeroPoint = static_cast<int32_t>(std::lround(-minValues[l] / outputScale));
+
+		inputScale = outputScale;
+		inputZeroPoint = quantizedLayer.outputZeroPoint;
+
+		maxStride = std::max(maxStride, quantizedLayer.inputsStride);
+		maxStride = std::max(maxStride, quantizedLayer.outputsCount);
+	}
+
+	m_inputs.resize(maxStride * BATCH_BLOCK_SIZE, 0);
+	m_outputs.resize(maxStride * BATCH_BLOCK_SIZE, 0);
+
+	size_t maxLayerSize = 0;
+	for (auto& layer : m_layers) {
+		maxLayerSize = std::max(maxLayerSize, layer.outputsCount);
+	}
+	m_values.resize(maxLayerSize * BATCH_BLOCK_SIZE);
+}
+
+void nn::QuantizedNetwork::evaluate(const uint8_t* inputs, size_t batch, uint8_t* outputs)
+{
+	size_t outputsCount = m_layers.back().outputsCount;
+
+	for (size_t first = 0; first < batch; first += BATCH_BLOCK_SIZE) {
+		size_t blockSize = std::min(BATCH_BLOCK_SIZE, batch - first);
+
+		// Samples are stored with stride of the first layer, padding stays zero
+		size_t stride = m_layers.front().inputsStride;
+		for (size_t k = 0; k < blockSize; ++k) {
+			const uint8_t* sample = inputs + (first + k) * m_inputsCount;
+			std::copy(sample, sample + m_inputsCount, m_inputs.begin() + k * stride);
+		}
+
+		for (size_t l = 0; l < m_layers.size(); ++l) {
+			const QuantizedLayer& layer = m_layers[l];
+
+			for (size_t k = 0; k < blockSize; ++k) {
+				const uint8_t* sample = m_inputs.data() + k * layer.inputsStride;
+				float* values = m_values.data() + k * layer.outputsCount;
+
+				for (size_t i = 0; i < layer.outputsCount; ++i) {
+					const int8_t* row = layer.weights.data() + i * layer.inputsStride;
+					values[i] = layer.multiplier * static_cast<float>(dot(sample, row, layer.inputsStride)) + layer.offsets[i];
+				}
+			}
+
+			size_t valuesCount = blockSize * layer.outputsCount;
+			ActivationFunction::evaluate(layer.activationType, m_values.data(), valuesCount, layer.activationPrecision);
+
+			// Requantizing to the layout of the next layer inputs
+			size_t nextStride = l + 1 < m_layers.size() ? m_layers[l + 1].inputsStride : layer.outputsCount;
+
+			float inverseScale = 1.0f / layer.outputScale;
+			float zeroPoint = static_cast<float>(layer.outputZeroPoint);
+
+			for (size_t k = 0; k < blockSize; ++k) {
+				const float* values = m_values.data() + k * layer.outputsCount;
+				uint8_t* sample = m_outputs.data() + k * nextStride;
+
+				for (size_t i = 0; i < layer.outputsCount; ++i) {
+					float value = std::min(std::max(values[i] * inverseScale + zeroPoint, 0.0f), 255.0f);
+					sample[i] = static_cast<uint8_t>(value + 0.5f);
+				}
+
+				std::fill(sample + layer.outputsCount, sample + nextStride, uint8_t(0));
+			}
+
+			std::swap(m_inputs, m_outputs);
+		}
+
+		std::copy(m_inputs.begin(), m_inputs.begin() + blockSize * outputsCount, outputs + first * outputsCount);
+	}
+}
+
+template<typename T>
+double nn::QuantizedNetwork::measurePsnr(const Network<T>& network, const T* inputs, size_t count)
+{
+	size_t outputsCount = m_layers.back().outputsCount;
+
+	std::vector<uint8_t> quantizedInputs(count * m_inputsCount);
+	for (size_t i = 0; i < quantizedInputs.size(); ++i) {
+		quantizedInputs[i] = toByte(static_cast<double>(inputs[i]));
+	}
+
+	std::vector<uint8_t> quantizedOutputs(count * outputsCount);
+	evaluate(quantizedInputs.data(), count, quantizedOutputs.data());
+
+	Workspace<T> workspace(network);
+	std::vector<T> outputs(count * outputsCount);
+	network.evaluate(inputs, count, outputs.data(), workspace);
+
+	double squaredError = 0.0;
+	for (size_t i = 0; i < outputs.size(); ++i) {
+		double difference = static_cast<double>(quantizedOutputs[i]) - static_cast<double>(outputs[i]) * 255.0;
+		squaredError += difference * difference;
+	}
+
+	double meanSquaredError = squaredError / static_cast<double>(outputs.size());
+	if (meanSquaredError == 0.0) {
+		return std::numeric_limits<double>::infinity();
+	}
+
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+template nn::QuantizedNetwork::QuantizedNetwork(const Network<float>& network, const float* calibrationInputs, size_t calibrationCount);
+template nn::QuantizedNetwork::QuantizedNetwork(const Network<double>& network, const double* calibrationInputs, size_t calibrationCount);
+
+template double nn::QuantizedNetwork::measurePsnr(const Network<float>& network, const float* inputs, size_t count);
+template double nn::QuantizedNetwork::measurePsnr(const Network<double>& network, const double* inputs, size_t count);
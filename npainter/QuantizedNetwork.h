@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Network.h"
+
+namespace nn
+{
+	// Inference-only 8-bit copy of a trained network. Weights are int8
+	// with one scale per layer, values passed between layers are uint8
+	// with per-layer scale and zero point, and products are accumulated
+	// in 32-bit integers. Network inputs and outputs are bytes mapped
+	// to [0, 1], so pixels are passed and returned as they are
+	class QuantizedNetwork
+	{
+	public:
+		// Hidden value ranges are taken from the source network outputs
+		// on calibration samples, which should come from training data
+		template<typename T>
+		QuantizedNetwork(const Network<T>& network, const T* calibrationInputs, size_t calibrationCount);
+
+		void evaluate(const uint8_t* inputs, size_t batch, uint8_t* outputs);
+
+		// Peak signal to noise ratio of quantized outputs against
+		// unrounded outputs of the source network, in decibels
+		template<typename T>
+		double measurePsnr(const Network<T>& network, const T* inputs, size_t count);
+
+	private:
+		struct QuantizedLayer
+		{
+			size_t inputsCount;
+			size_t outputsCount;
+			// Rows and inputs are padded with zeros to a multiple of INPUTS_ALIGNMENT
+			size_t inputsStride;
+
+			utils::AlignedVector<int8_t> weights;
+
+			// Neuron sum is multiplier * dot(weights, inputs) + offset
+			float multiplier;
+			std::vector<float> offsets;
+
+			ActivationFunction::Type activationType;
+			Precision activationPrecision;
+
+			float outputScale;
+			int32_t outputZeroPoint;
+		};
+
+		static const size_t INPUTS_ALIGNMENT = 16;
+		static const size_t BATCH_BLOCK_SIZE = 64;
+
+		size_t m_inputsCount;
+		std::vector<QuantizedLayer> m_layers;
+
+		utils::AlignedVector<uint8_t> m_inputs;
+		utils::AlignedVector<uint8_t> m_outputs;
+		utils::AlignedVector<float> m_values;
+	};
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#define NPAINTER_SSE2
+#endif
+
+namespace nn
+{
+	// Thin wrappers over scalar, SSE2 and AVX2 arithmetic, so that one
+	// kernel template can be instantiated for every instruction set
+	namespace simd
+	{
+		// Scalar operations, used for tails and on targets without SIMD
+		template<typename T>
+		struct ScalarOps
+		{
+			using Scalar = T;
+			using Vector = T;
+			static const size_t WIDTH = 1;
+
+			// 2^x must stay a normal number
+			static constexpr T EXPONENT_LIMIT = sizeof(T) == 4 ? T(126) : T(1022);
+
+			static Vector load(const T* pointer) { return *pointer; }
+			static void store(T* pointer, Vector value) { *pointer = value; }
+			static Vector set(T value) { return value; }
+
+			static Vector add(Vector a, Vector b) { return a + b; }
+			static Vector sub(Vector a, Vector b) { return a - b; }
+			static Vector mul(Vector a, Vector b) { return a * b; }
+			static Vector div(Vector a, Vector b) { return a / b; }
+			static Vector min(Vector a, Vector b) { return a < b ? a : b; }
+			static Vector max(Vector a, Vector b) { return a > b ? a : b; }
+
+			static Vector sqrt(Vector a) { return std::sqrt(a); }
+
+			// Masks are 1 for true and 0 for false
+			static Vector less(Vector a, Vector b) { return a < b ? T(1) : T(0); }
+			static Vector greater(Vector a, Vector b) { return a > b ? T(1) : T(0); }
+			static Vector select(Vector mask, Vector a, Vector b) { return mask != T(0) ? a : b; }
+
+			// Returns 2^round(x) and stores x - round(x) into fraction
+			static Vector splitExp2(Vector x, Vector& fraction)
+			{
+				T integer = std::nearbyint(x);
+				fraction = x - integer;
+				return std::ldexp(T(1), static_cast<int>(integer));
+			}
+		};
+
+#ifdef NPAINTER_SSE2
+		struct SseFloatOps
+		{
+			using Scalar = float;
+			using Vector = __m128;
+			static const size_t WIDTH = 4;
+
+			static constexpr float EXPONENT_LIMIT = 126.0f;
+
+			static Vector load(const float* pointer) { return _mm_loadu_ps(pointer); }
+			static void store(float* pointer, Vector value) { _mm_storeu_ps(pointer, value); }
+			static Vector set(float value) { return _mm_set1_ps(value); }
+
+			static Vector add(Vector a, Vector b) { return _mm_add_ps(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm_sub_ps(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm_mul_ps(a, b); }
+			static Vector div(Vector a, Vector b) { return _mm_div_ps(a, b); }
+			static Vector min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+			static Vector max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+
+			static Vector sqrt(Vector a) { return _mm_sqrt_ps(a); }
+
+			static Vector less(Vector a, Vector b) { return _mm_cmplt_ps(a, b); }
+			static Vector greater(Vector a, Vector b) { return _mm_cmpgt_ps(a, b); }
+			static Vector select(Vector mask, Vector a, Vector b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+			static Vector splitExp2(Vector x, Vector& fraction)
+			{
+				__m128i integer = _mm_cvtps_epi32(x);
+				fraction = _mm_sub_ps(x, _mm_cvtepi32_ps(integer));
+
+				__m128i exponent = _mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23);
+				return _mm_castsi128_ps(exponent);
+			}
+		};
+
+		struct SseDoubleOps
+		{
+			using Scalar = double;
+			using Vector = __m128d;
+			static const size_t WIDTH = 2;
+
+			static constexpr double EXPONENT_LIMIT = 1022.0;
+
+			static Vector load(const double* pointer) { return _mm_loadu_pd(pointer); }
+			static void store(double* pointer, Vector value) { _mm_storeu_pd(pointer, value); }
+			static Vector set(double value) { return _mm_set1_pd(value); }
+
+			static Vector add(Vector a, Vector b) { return _mm_add_pd(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm_sub_pd(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm_mul_pd(a, b); }
+			static Vector div(Vector a, Vector b) { return _mm_div_pd(a, b); }
+			static Vector min(Vector a, Vector b) { return _mm_min_pd(a, b); }
+			static Vector max(Vector a, Vector b) { return _mm_max_pd(a, b); }
+
+			static Vector sqrt(Vector a) { return _mm_sqrt_pd(a); }
+
+			static Vector less(Vector a, Vector b) { return _mm_cmplt_pd(a, b); }
+			static Vector greater(Vector a, Vector b) { return _mm_cmpgt_pd(a, b); }
+			static Vector select(Vector mask, Vector a, Vector b) { return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b)); }
+
+			static Vector splitExp2(Vector x, Vector& fraction)
+			{
+				__m128i integer = _mm_cvtpd_epi32(x);
+				fraction = _mm_sub_pd(x, _mm_cvtepi32_pd(integer));
+
+				// Biased exponent is always positive, so it is zero extended to 64 bits
+				__m128i biased = _mm_add_epi32(integer, _mm_set1_epi32(1023));
+				__m128i exponent = _mm_slli_epi64(_mm_unpacklo_epi32(biased, _mm_setzero_si128()), 52);
+				return _mm_castsi128_pd(exponent);
+			}
+		};
+#endif
+
+#ifdef __AVX2__
+		struct AvxFloatOps
+		{
+			using Scalar = float;
+			using Vector = __m256;
+			static const size_t WIDTH = 8;
+
+			static constexpr float EXPONENT_LIMIT = 126.0f;
+
+			static Vector load(const float* pointer) { return _mm256_loadu_ps(pointer); }
+			static void store(float* pointer, Vector value) { _mm256_storeu_ps(pointer, value); }
+			static Vector set(float value) { return _mm256_set1_ps(value); }
+
+			static Vector add(Vector a, Vector b) { return _mm256_add_ps(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm256_sub_ps(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm256_mul_ps(a, b); }
+			static Vector div(Vector a, Vector b) { return _mm256_div_ps(a, b); }
+			static Vector min(Vector a, Vector b) { return _mm256_min_ps(a, b); }
+			static Vector max(Vector a, Vector b) { return _mm256_max_ps(a, b); }
+
+			static Vector sqrt(Vector a) { return _mm256_sqrt_ps(a); }
+
+			static Vector less(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+			static Vector greater(Vector a, Vector b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+			static Vector select(Vector mask, Vector a, Vector b) { return _mm256_blendv_ps(b, a, mask); }
+
+			static Vector splitExp2(Vector x, Vector& fraction)
+			{
+				__m256i integer = _mm256_cvtps_epi32(x);
+				fraction = _mm256_sub_ps(x, _mm256_cvtepi32_ps(integer));
+
+				__m256i exponent = _mm256_slli_epi32(_mm256_add_epi32(integer, _mm256_set1_epi32(127)), 23);
+				return _mm256_castsi256_ps(exponent);
+			}
+		};
+
+		struct AvxDoubleOps
+		{
+			using Scalar = double;
+			using Vector = __m256d;
+			static const size_t WIDTH = 4;
+
+			static constexpr double EXPONENT_LIMIT = 1022.0;
+
+			static Vector load(const double* pointer) { return _mm256_loadu_pd(pointer); }
+			static void store(double* pointer, Vector value) { _mm256_storeu_pd(pointer, value); }
+			static Vector set(double value) { return _mm256_set1_pd(value); }
+
+			static Vector add(Vector a, Vector b) { return _mm256_add_pd(a, b); }
+			static Vector sub(Vector a, Vector b) { return _mm256_sub_pd(a, b); }
+			static Vector mul(Vector a, Vector b) { return _mm256_mul_pd(a, b); }
+			static Vector div(Vector a, Vector b) { return _mm256_div_pd(a, b); }
+			static Vector min(Vector a, Vector b) { return _mm256_min_pd(a, b); }
+			static Vector max(Vector a, Vector b) { return _mm256_max_pd(a, b); }
+
+			static Vector sqrt(Vector a) { return _mm256_sqrt_pd(a); }
+
+			static Vector less(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+			static Vector greater(Vector a, Vector b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+			static Vector select(Vector mask, Vector a, Vector b) { return _mm256_blendv_pd(b, a, mask); }
+
+			static Vector splitExp2(Vector x, Vector& fraction)
+			{
+				__m128i integer = _mm256_cvtpd_epi32(x);
+				fraction = _mm256_sub_pd(x, _mm256_cvtepi32_pd(integer));
+
+				__m128i biased = _mm_add_epi32(integer, _mm_set1_epi32(1023));
+				__m256i exponent = _mm256_slli_epi64(_mm256_cvtepu32_epi64(biased), 52);
+				return _mm256_castsi256_pd(exponent);
+			}
+		};
+#endif
+
+		// Widest available operations for each scalar type
+		template<typename T>
+		struct VectorOps
+		{
+			using Type = ScalarOps<T>;
+		};
+
+#if defined(__AVX2__)
+		template<>
+		struct VectorOps<float>
+		{
+			using Type = AvxFloatOps;
+		};
+
+		template<>
+		struct VectorOps<double>
+		{
+			using Type = AvxDoubleOps;
+		};
+#elif defined(NPAINTER_SSE2)
+		template<>
+		struct VectorOps<float>
+		{
+			using Type = SseFloatOps;
+		};
+
+		template<>
+		struct VectorOps<double>
+		{
+			using Type = SseDoubleOps;
+		};
+#endif
+	}
+}
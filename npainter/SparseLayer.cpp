@@ -0,0 +1,86 @@
+#include "SparseLayer.h"
+
+template<typename T>
+nn::SparseLayer<T>::SparseLayer(const Layer<T>& layer) :
+	m_activationType(layer.getActivationType()), m_activationPrecision(layer.getActivationPrecision()),
+	m_inputsCount(layer.getInputsCount()), m_outputsCount(layer.getOutputsCount()),
+	m_biases(layer.getBiases(), layer.getBiases() + layer.getOutputsCount())
+{
+	const T* weights = layer.getWeights();
+
+	m_rowOffsets.reserve(m_outputsCount + 1);
+	m_rowOffsets.push_back(0);
+
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		const T* row = weights + i * m_inputsCount;
+
+		for (size_t j = 0; j < m_inputsCount; ++j) {
+			if (row[j] != T(0)) {
+				m_columns.push_back(static_cast<uint32_t>(j));
+				m_weights.push_back(row[j]);
+			}
+		}
+
+		m_rowOffsets.push_back(static_cast<uint32_t>(m_columns.size()));
+	}
+}
+
+template<typename T>
+size_t nn::SparseLayer<T>::getInputsCount() const
+{
+	return m_inputsCount;
+}
+
+template<typename T>
+size_t nn::SparseLayer<T>::getOutputsCount() const
+{
+	return m_outputsCount;
+}
+
+template<typename T>
+size_t nn::SparseLayer<T>::getNonZerosCount() const
+{
+	return m_weights.size();
+}
+
+template<typename T>
+void nn::SparseLayer<T>::feedForward(const T* inputs, size_t batch, T* outputs) const
+{
+	for (size_t i = 0; i < m_outputsCount; ++i) {
+		T* output = outputs + i * batch;
+
+		T bias = m_biases[i];
+		for (size_t k = 0; k < batch; ++k) {
+			output[k] = bias;
+		}
+
+		// Two weights per pass halve loads and stores of the output row
+		size_t n = m_rowOffsets[i];
+		size_t end = m_rowOffsets[i + 1];
+
+		for (; n + 2 <= end; n += 2) {
+			const T firstWeight = m_weights[n];
+			const T secondWeight = m_weights[n + 1];
+			const T* firstInput = inputs + m_columns[n] * batch;
+			const T* secondInput = inputs + m_columns[n + 1] * batch;
+
+			for (size_t k = 0; k < batch; ++k) {
+				output[k] += firstWeight * firstInput[k] + secondWeight * secondInput[k];
+			}
+		}
+
+		if (n < end) {
+			const T weight = m_weights[n];
+			const T* input = inputs + m_columns[n] * batch;
+
+			for (size_t k = 0; k < batch; ++k) {
+				output[k] += weight * input[k];
+			}
+		}
+	}
+
+	ActivationFunction::evaluate(m_activationType, outputs, m_outputsCount * batch, m_activationPrecision);
+}
+
+template class nn::SparseLayer<float>;
+template class nn::SparseLayer<double>;
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Layer.h"
+
+namespace nn
+{
+	// Inference-only copy of a pruned layer. Nonzero weights are stored in
+	// compressed sparse rows: columns and weights of row i are at positions
+	// [rowOffsets[i], rowOffsets[i + 1]). Batches use the same feature-major
+	// layout as Layer, so each stored weight is applied to the whole
+	// contiguous row of inputs and the sample loop is vectorized
+	template<typename T>
+	class SparseLayer
+	{
+	public:
+		SparseLayer(const Layer<T>& layer);
+
+		size_t getInputsCount() const;
+		size_t getOutputsCount() const;
+		size_t getNonZerosCount() const;
+
+		void feedForward(const T* inputs, size_t batch, T* outputs) const;
+
+	private:
+		ActivationFunction::Type m_activationType;
+		Precision m_activationPrecision;
+
+		size_t m_inputsCount;
+		size_t m_outputsCount;
+
+		std::vector<uint32_t> m_rowOffsets;
+		std::vector<uint32_t> m_columns;
+		utils::AlignedVector<T> m_weights;
+		utils::AlignedVector<T> m_biases;
+	};
+}
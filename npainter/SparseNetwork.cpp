@@ -0,0 +1,73 @@
+#include "SparseNetwork.h"
+
+#include <algorithm>
+
+template<typename T>
+const size_t nn::SparseNetwork<T>::BATCH_BLOCK_SIZE;
+
+template<typename T>
+nn::SparseNetwork<T>::SparseNetwork(const Network<T>& network) :
+	m_inputsCount(network.getInputsCount())
+{
+	size_t maxLayerSize = m_inputsCount;
+
+	for (auto& layer : network.getLayers()) {
+		m_layers.emplace_back(layer);
+		maxLayerSize = std::max(maxLayerSize, layer.getOutputsCount());
+	}
+
+	m_batchInputs.resize(maxLayerSize * BATCH_BLOCK_SIZE);
+	m_batchOutputs.resize(maxLayerSize * BATCH_BLOCK_SIZE);
+}
+
+template<typename T>
+void nn::SparseNetwork<T>::evaluate(const T* inputs, size_t batch, T* outputs)
+{
+	size_t outputsCount = m_layers.back().getOutputsCount();
+
+	for (size_t first = 0; first < batch; first += BATCH_BLOCK_SIZE) {
+		size_t blockSize = std::min(BATCH_BLOCK_SIZE, batch - first);
+
+		const T* blockInputs = inputs + first * m_inputsCount;
+		T* blockOutputs = outputs + first * outputsCount;
+
+		T* layerInputs = m_batchInputs.data();
+		T* layerOutputs = m_batchOutputs.data();
+
+		// Transposing samples to feature-major layout
+		for (size_t k = 0; k < blockSize; ++k) {
+			for (size_t j = 0; j < m_inputsCount; ++j) {
+				layerInputs[j * blockSize + k] = blockInputs[k * m_inputsCount + j];
+			}
+		}
+
+		for (auto& layer : m_layers) {
+			layer.feedForward(layerInputs, blockSize, layerOutputs);
+			std::swap(layerInputs, layerOutputs);
+		}
+
+		// Transposing results back
+		for (size_t k = 0; k < blockSize; ++k) {
+			for (size_t j = 0; j < outputsCount; ++j) {
+				blockOutputs[k * outputsCount + j] = layerInputs[j * blockSize + k];
+			}
+		}
+	}
+}
+
+template<typename T>
+T nn::SparseNetwork<T>::getSparsity() const
+{
+	size_t weightsCount = 0;
+	size_t nonZerosCount = 0;
+
+	for (auto& layer : m_layers) {
+		weightsCount += layer.getInputsCount() * layer.getOutputsCount();
+		nonZerosCount += layer.getNonZerosCount();
+	}
+
+	return T(1) - static_cast<T>(nonZerosCount) / static_cast<T>(weightsCount);
+}
+
+template class nn::SparseNetwork<float>;
+template class nn::SparseNetwork<double>;
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "Network.h"
+#include "SparseLayer.h"
+
+namespace nn
+{
+	// Inference-only copy of a pruned network, every layer is stored
+	// as SparseLayer. Samples are processed in blocks like in Network
+	template<typename T>
+	class SparseNetwork
+	{
+	public:
+		static const size_t BATCH_BLOCK_SIZE = 64;
+
+		SparseNetwork(const Network<T>& network);
+
+		void evaluate(const T* inputs, size_t batch, T* outputs);
+
+		// Fraction of zero weights over all layers
+		T getSparsity() const;
+
+	private:
+		size_t m_inputsCount;
+		std::vector<SparseLayer<T>> m_layers;
+
+		utils::AlignedVector<T> m_batchInputs;
+		utils::AlignedVector<T> m_batchOutputs;
+	};
+}
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <stdexcept>
+
+#include "Network.h"
+
+namespace nn
+{
+	// Inference interface shared by static and dynamic networks
+	template<typename T>
+	class Evaluator
+	{
+	public:
+		virtual ~Evaluator() {}
+
+		virtual void evaluate(const T* inputs, size_t batch, T* outputs) = 0;
+	};
+
+	// Fully connected layer with compile-time size. Weights are stored
+	// transposed, so the inner loop runs over outputs without reductions
+	template<typename T, size_t Inputs, size_t Outputs>
+	class StaticLayer
+	{
+	public:
+		void assign(const Layer<T>& layer)
+		{
+			const T* weights = layer.getWeights();
+			for (size_t i = 0; i < Outputs; ++i) {
+				for (size_t j = 0; j < Inputs; ++j) {
+					m_weights[j * Outputs + i] = weights[i * Inputs + j];
+				}
+			}
+
+			std::copy(layer.getBiases(), layer.getBiases() + Outputs, m_biases.begin());
+			m_activationType = layer.getActivationType();
+			m_activationPrecision = layer.getActivationPrecision();
+		}
+
+		void feedForward(const T* inputs, T* outputs) const
+		{
+			alignas(64) std::array<T, Outputs> sums = m_biases;
+
+			for (size_t j = 0; j < Inputs; ++j) {
+				const T input = inputs[j];
+				for (size_t i = 0; i < Outputs; ++i) {
+					sums[i] += m_weights[j * Outputs + i] * input;
+				}
+			}
+
+			ActivationFunction::evaluate(m_activationType, sums.data(), Outputs, m_activationPrecision);
+			std::copy(sums.begin(), sums.end(), outputs);
+		}
+
+	private:
+		std::array<T, Inputs * Outputs> m_weights;
+		std::array<T, Outputs> m_biases;
+		ActivationFunction::Type m_activationType;
+		Precision m_activationPrecision;
+	};
+
+	namespace detail
+	{
+		// Chain of static layers, where each layer feeds the next one
+		template<typename T, size_t Inputs, size_t Outputs, size_t... Rest>
+		class StaticLayers
+		{
+		public:
+			static const size_t OUTPUTS = StaticLayers<T, Outputs, Rest...>::OUTPUTS;
+
+			static bool matches(const std::vector<Layer<T>>& layers, size_t index)
+			{
+				return index < layers.size() &&
+					layers[index].getInputsCount() == Inputs && layers[index].getOutputsCount() == Outputs &&
+					StaticLayers<T, Outputs, Rest...>::matches(layers, index + 1);
+			}
+
+			void assign(const std::vector<Layer<T>>& layers, size_t index)
+			{
+				m_layer.assign(layers[index]);
+				m_next.assign(layers, index + 1);
+			}
+
+			void evaluate(const T* inputs, T* outputs) const
+			{
+				alignas(64) std::array<T, Outputs> values;
+				m_layer.feedForward(inputs, values.data());
+				m_next.evaluate(values.data(), outputs);
+			}
+
+		private:
+			StaticLayer<T, Inputs, Outputs> m_layer;
+			StaticLayers<T, Outputs, Rest...> m_next;
+		};
+
+		template<typename T, size_t Inputs, size_t Outputs>
+		class StaticLayers<T, Inputs, Outputs>
+		{
+		public:
+			static const size_t OUTPUTS = Outputs;
+
+			static bool matches(const std::vector<Layer<T>>& layers, size_t index)
+			{
+				return index + 1 == layers.size() &&
+					layers[index].getInputsCount() == Inputs && layers[index].getOutputsCount() == Outputs;
+			}
+
+			void assign(const std::vector<Layer<T>>& layers, size_t index)
+			{
+				m_layer.assign(layers[index]);
+			}
+
+			void evaluate(const T* inputs, T* outputs) const
+			{
+				m_layer.feedForward(inputs, outputs);
+			}
+
+		private:
+			StaticLayer<T, Inputs, Outputs> m_layer;
+		};
+	}
+
+	// Snapshot of a network with topology known at compile time.
+	// All loop bounds are constants, so small layers are fully unrolled
+	template<typename T, size_t Inputs, size_t... Sizes>
+	class StaticNetwork : public Evaluator<T>
+	{
+	public:
+		static const size_t INPUTS = Inputs;
+		static const size_t OUTPUTS = detail::StaticLayers<T, Inputs, Sizes...>::OUTPUTS;
+
+		static bool matches(const Network<T>& network)
+		{
+			return network.getInputsCount() == Inputs &&
+				detail::StaticLayers<T, Inputs, Sizes...>::matches(network.getLayers(), 0);
+		}
+
+		StaticNetwork(const Network<T>& network)
+		{
+			if (!matches(network)) {
+				throw std::runtime_error("Network topology doesn't match static network");
+			}
+
+			m_layers.assign(network.getLayers(), 0);
+		}
+
+		void evaluate(const T* inputs, size_t batch, T* outputs) override
+		{
+			for (size_t k = 0; k < batch; ++k) {
+				m_layers.evaluate(inputs + k * INPUTS, outputs + k * OUTPUTS);
+			}
+		}
+
+	private:
+		detail::StaticLayers<T, Inputs, Sizes...> m_layers;
+	};
+
+	// Snapshot of a network with arbitrary topology
+	template<typename T>
+	class DynamicNetwork : public Evaluator<T>
+	{
+	public:
+		DynamicNetwork(const Network<T>& network) :
+			m_network(network)
+		{}
+
+		void evaluate(const T* inputs, size_t batch, T* outputs) override
+		{
+			m_network.evaluate(inputs, batch, outputs);
+		}
+
+	private:
+		Network<T> m_network;
+	};
+
+	namespace detail
+	{
+		template<typename T>
+		std::unique_ptr<Evaluator<T>> createFirstMatching(const Network<T>& network)
+		{
+			return std::make_unique<DynamicNetwork<T>>(network);
+		}
+
+		template<typename T, typename Static, typename... Rest>
+		std::unique_ptr<Evaluator<T>> createFirstMatching(const Network<T>& network)
+		{
+			if (Static::matches(network)) {
+				return std::make_unique<Static>(network);
+			}
+
+			return createFirstMatching<T, Rest...>(network);
+		}
+	}
+
+	// Creates the fastest evaluator for the network. Topologies of
+	// 1x1, 3x3 and 5x5 RGB kernels are specialized at compile time,
+	// other networks fall back to the dynamic implementation
+	template<typename T>
+	std::unique_ptr<Evaluator<T>> createEvaluator(const Network<T>& network)
+	{
+		return detail::createFirstMatching<T,
+			StaticNetwork<T, 3, 1, 3>,
+			StaticNetwork<T, 27, 9, 3>,
+			StaticNetwork<T, 75, 25, 3>>(network);
+	}
+}
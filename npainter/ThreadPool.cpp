@@ -0,0 +1,84 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+utils::ThreadPool::ThreadPool(size_t threadsCount) :
+	m_task(nullptr), m_tasksCount(0), m_nextTask(0), m_finishedTasksCount(0), m_isStopping(false)
+{
+	threadsCount = std::max<size_t>(threadsCount, 1);
+
+	m_threads.reserve(threadsCount);
+	for (size_t i = 0; i < threadsCount; ++i) {
+		m_threads.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+utils::ThreadPool::~ThreadPool()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_isStopping = true;
+	}
+
+	m_tasksAvailable.notify_all();
+
+	for (auto& thread : m_threads) {
+		thread.join();
+	}
+}
+
+size_t utils::ThreadPool::getThreadsCount() const
+{
+	return m_threads.size();
+}
+
+void utils::ThreadPool::run(size_t tasksCount, const std::function<void(size_t)>& task)
+{
+	if (tasksCount == 0) {
+		return;
+	}
+
+	// Only one batch of tasks can be executed at a time
+	std::unique_lock<std::mutex> runLock(m_runMutex);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_task = &task;
+	m_tasksCount = tasksCount;
+	m_nextTask = 0;
+	m_finishedTasksCount = 0;
+
+	m_tasksAvailable.notify_all();
+
+	m_tasksFinished.wait(lock, [this]() {
+		return m_finishedTasksCount == m_tasksCount;
+	});
+
+	m_task = nullptr;
+	m_tasksCount = 0;
+}
+
+void utils::ThreadPool::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (true) {
+		m_tasksAvailable.wait(lock, [this]() {
+			return m_isStopping || m_nextTask < m_tasksCount;
+		});
+
+		if (m_isStopping) {
+			return;
+		}
+
+		size_t index = m_nextTask++;
+		const std::function<void(size_t)>& task = *m_task;
+
+		lock.unlock();
+		task(index);
+		lock.lock();
+
+		if (++m_finishedTasksCount == m_tasksCount) {
+			m_tasksFinished.notify_one();
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils
+{
+	// Fixed set of worker threads executing indexed tasks
+	class ThreadPool
+	{
+	public:
+		ThreadPool(size_t threadsCount = std::thread::hardware_concurrency());
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		size_t getThreadsCount() const;
+
+		// Calls task(i) for every i in [0, tasksCount) on the pool
+		// threads and blocks until all of them are finished
+		void run(size_t tasksCount, const std::function<void(size_t)>& task);
+
+	private:
+		void workerLoop();
+
+		std::vector<std::thread> m_threads;
+
+		std::mutex m_runMutex;
+
+		std::mutex m_mutex;
+		std::condition_variable m_tasksAvailable;
+		std::condition_variable m_tasksFinished;
+
+		const std::function<void(size_t)>* m_task;
+		size_t m_tasksCount;
+		size_t m_nextTask;
+		size_t m_finishedTasksCount;
+
+		bool m_isStopping;
+	};
+}
@@ -0,0 +1,208 @@
+#include "TrainingSampler.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace
+{
+	// Upper bounds of contrast levels, the last level takes the rest
+	const int CONTRAST_THRESHOLDS[] = { 8, 24, 64 };
+
+	int getBrightness(const uint8_t* color)
+	{
+		return (color[0] * 2 + color[1] * 5 + color[2]) / 8;
+	}
+}
+
+const size_t utils::TrainingSampler::BRIGHTNESS_LEVELS;
+const size_t utils::TrainingSampler::CONTRAST_LEVELS;
+const int utils::TrainingSampler::TILE_SIZE;
+
+utils::TrainingSampler::TrainingSampler(const PatchDataset& dataset, uint32_t seed) :
+	m_dataset(dataset), m_seed(seed), m_generator(seed)
+{
+	static_assert(sizeof(CONTRAST_THRESHOLDS) / sizeof(CONTRAST_THRESHOLDS[0]) + 1 == CONTRAST_LEVELS,
+		"Contrast thresholds don't match levels");
+}
+
+void utils::TrainingSampler::setSeed(uint32_t seed)
+{
+	m_seed = seed;
+	m_generator.seed(seed);
+}
+
+uint32_t utils::TrainingSampler::getSeed() const
+{
+	return m_seed;
+}
+
+void utils::TrainingSampler::select(Policy policy, Order order, size_t count, std::vector<uint32_t>& indices)
+{
+	size_t samplesCount = m_dataset.getSamplesCount();
+	count = std::min(count, samplesCount);
+
+	indices.clear();
+	if (samplesCount == 0) {
+		return;
+	}
+
+	switch (policy) {
+	case Policy::All:
+		indices.resize(samplesCount);
+		for (size_t i = 0; i < samplesCount; ++i) {
+			indices[i] = static_cast<uint32_t>(i);
+		}
+		break;
+
+	case Policy::Uniform: {
+		std::uniform_int_distribution<uint32_t> distribution(0, static_cast<uint32_t>(samplesCount - 1));
+
+		indices.resize(count);
+		for (auto& index : indices) {
+			index = distribution(m_generator);
+		}
+		break;
+	}
+
+	case Policy::Stratified: {
+		if (m_strataOffsets.empty()) {
+			buildStrata();
+		}
+
+		size_t strataCount = m_strataOffsets.size() - 1;
+		size_t nonEmptyCount = 0;
+		for (size_t s = 0; s < strataCount; ++s) {
+			nonEmptyCount += m_strataOffsets[s + 1] > m_strataOffsets[s];
+		}
+
+		// Remainder goes to the first strata
+		size_t share = count / nonEmptyCount;
+		size_t remainder = count % nonEmptyCount;
+
+		indices.reserve(count);
+		for (size_t s = 0; s < strataCount; ++s) {
+			size_t first = m_strataOffsets[s];
+			size_t last = m_strataOffsets[s + 1];
+			if (first == last) {
+				continue;
+			}
+
+			size_t stratumCount = share + (remainder > 0 ? 1 : 0);
+			remainder -= remainder > 0 ? 1 : 0;
+
+			std::uniform_int_distribution<size_t> distribution(first, last - 1);
+			for (size_t i = 0; i < stratumCount; ++i) {
+				indices.push_back(m_strataSamples[distribution(m_generator)]);
+			}
+		}
+		break;
+	}
+	}
+
+	arrange(order, indices);
+}
+
+void utils::TrainingSampler::buildStrata()
+{
+	size_t samplesCount = m_dataset.getSamplesCount();
+	size_t inputsCount = m_dataset.getInputsCount();
+	const size_t channelsCount = PatchDataset::CHANNELS_COUNT;
+
+	// Center pixel of the kernel, the first one if kernel doesn't contain it
+	const std::vector<QPoint>& kernel = m_dataset.getKernel();
+	size_t center = std::find(kernel.begin(), kernel.end(), QPoint(0, 0)) - kernel.begin();
+	if (center == kernel.size()) {
+		center = 0;
+	}
+
+	std::vector<uint8_t> strata(samplesCount);
+	m_strataOffsets.assign(BRIGHTNESS_LEVELS * CONTRAST_LEVELS + 1, 0);
+
+	for (size_t i = 0; i < samplesCount; ++i) {
+		const uint8_t* inputs = m_dataset.getInputs(i);
+		int brightness = getBrightness(inputs + center * channelsCount);
+
+		// Largest brightness difference from the center pixel
+		int contrast = 0;
+		for (size_t j = 0; j < inputsCount; j += channelsCount) {
+			contrast = std::max(contrast, std::abs(getBrightness(inputs + j) - brightness));
+		}
+
+		size_t contrastLevel = 0;
+		while (contrastLevel + 1 < CONTRAST_LEVELS && contrast > CONTRAST_THRESHOLDS[contrastLevel]) {
+			++contrastLevel;
+		}
+
+		size_t stratum = brightness * BRIGHTNESS_LEVELS / 256 * CONTRAST_LEVELS + contrastLevel;
+		strata[i] = static_cast<uint8_t>(stratum);
+		++m_strataOffsets[stratum + 1];
+	}
+
+	// Counting sort of samples by stratum
+	for (size_t s = 1; s < m_strataOffsets.size(); ++s) {
+		m_strataOffsets[s] += m_strataOffsets[s - 1];
+	}
+
+	std::vector<size_t> positions(m_strataOffsets.begin(), m_strataOffsets.end() - 1);
+	m_strataSamples.resize(samplesCount);
+	for (size_t i = 0; i < samplesCount; ++i) {
+		m_strataSamples[positions[strata[i]]++] = static_cast<uint32_t>(i);
+	}
+}
+
+void utils::TrainingSampler::arrange(Order order, std::vector<uint32_t>& indices)
+{
+	switch (order) {
+	case Order::Raster:
+		// All samples are already in order
+		if (!std::is_sorted(indices.begin(), indices.end())) {
+			std::sort(indices.begin(), indices.end());
+		}
+		break;
+
+	case Order::Shuffled:
+		std::shuffle(indices.begin(), indices.end(), m_generator);
+		break;
+
+	case Order::BlockShuffled: {
+		size_t width = static_cast<size_t>(m_dataset.getWidth());
+		size_t tilesInRow = (width + TILE_SIZE - 1) / TILE_SIZE;
+		size_t tilesCount = tilesInRow * ((m_dataset.getHeight() + TILE_SIZE - 1) / TILE_SIZE);
+
+		auto getTile = [&](uint32_t index) {
+			return index / width / TILE_SIZE * tilesInRow + index % width / TILE_SIZE;
+		};
+
+		m_tileRanks.resize(tilesCount);
+		for (size_t t = 0; t < tilesCount; ++t) {
+			m_tileRanks[t] = static_cast<uint32_t>(t);
+		}
+		std::shuffle(m_tileRanks.begin(), m_tileRanks.end(), m_generator);
+
+		// Counting sort by tile rank, then shuffling inside of every tile
+		m_tileOffsets.assign(tilesCount + 1, 0);
+		for (auto index : indices) {
+			++m_tileOffsets[m_tileRanks[getTile(index)] + 1];
+		}
+
+		for (size_t t = 1; t <= tilesCount; ++t) {
+			m_tileOffsets[t] += m_tileOffsets[t - 1];
+		}
+
+		m_arrangedIndices.resize(indices.size());
+		for (auto index : indices) {
+			m_arrangedIndices[m_tileOffsets[m_tileRanks[getTile(index)]]++] = index;
+		}
+
+		// Offsets now point to ends of tiles
+		size_t first = 0;
+		for (size_t t = 0; t < tilesCount; ++t) {
+			std::shuffle(m_arrangedIndices.begin() + first, m_arrangedIndices.begin() + m_tileOffsets[t], m_generator);
+			first = m_tileOffsets[t];
+		}
+
+		indices.swap(m_arrangedIndices);
+		break;
+	}
+	}
+}
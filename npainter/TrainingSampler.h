@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "PatchDataset.h"
+
+namespace utils
+{
+	// Chooses samples of a PatchDataset for every training epoch, so that
+	// epoch time depends on the sample count instead of the image size.
+	// Samples are drawn with replacement from precomputed index lists
+	class TrainingSampler
+	{
+	public:
+		enum class Policy
+		{
+			// Every sample once
+			All,
+			// Samples drawn uniformly from the whole image
+			Uniform,
+			// Equal share of samples from every non-empty stratum of center
+			// pixel brightness and patch contrast, so that rare edges and
+			// highlights are seen as often as flat areas
+			Stratified
+		};
+
+		// Order in which selected samples are visited
+		enum class Order
+		{
+			// Raster order of the image, neighbour samples are correlated
+			Raster,
+			// Random permutation
+			Shuffled,
+			// Square tiles in random order, samples of a tile together in
+			// random order, keeps memory accesses local
+			BlockShuffled
+		};
+
+		static const size_t BRIGHTNESS_LEVELS = 4;
+		static const size_t CONTRAST_LEVELS = 4;
+		static const int TILE_SIZE = 8;
+
+		TrainingSampler(const PatchDataset& dataset, uint32_t seed = std::random_device()());
+
+		// Restarts the random sequence, same seed gives the same epochs
+		void setSeed(uint32_t seed);
+		uint32_t getSeed() const;
+
+		// Replaces indices with samples of the next epoch. Count is
+		// ignored by Policy::All and limited by the samples count
+		void select(Policy policy, Order order, size_t count, std::vector<uint32_t>& indices);
+
+	private:
+		// Sorts samples into strata, done on the first stratified epoch
+		void buildStrata();
+
+		void arrange(Order order, std::vector<uint32_t>& indices);
+
+		const PatchDataset& m_dataset;
+		uint32_t m_seed;
+		std::mt19937 m_generator;
+
+		// Buffers of block shuffling
+		std::vector<uint32_t> m_tileRanks;
+		std::vector<size_t> m_tileOffsets;
+		std::vector<uint32_t> m_arrangedIndices;
+
+		// Samples grouped by stratum, stratum s is
+		// [m_strataOffsets[s], m_strataOffsets[s + 1])
+		std::vector<uint32_t> m_strataSamples;
+		std::vector<size_t> m_strataOffsets;
+	};
+}
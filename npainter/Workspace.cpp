@@ -0,0 +1,104 @@
+#include "Workspace.h"
+
+#include <algorithm>
+
+#include "Network.h"
+
+template<typename T>
+const size_t nn::Workspace<T>::BATCH_BLOCK_SIZE;
+
+template<typename T>
+nn::Workspace<T>::Workspace(const Network<T>& network) :
+	m_bufferSize(0), m_errorSum(T(0))
+{
+	const std::vector<Layer<T>>& layers = network.getLayers();
+
+	size_t maxLayerSize = network.getInputsCount();
+
+	m_layers.resize(layers.size());
+	for (size_t i = 0; i < layers.size(); ++i) {
+		LayerBuffers& buffers = m_layers[i];
+
+		buffers.outputsCount = layers[i].getOutputsCount();
+		buffers.weightsCount = layers[i].getOutputsCount() * layers[i].getInputsCount();
+
+		buffers.sums = reserve(buffers.outputsCount);
+		buffers.values = reserve(buffers.outputsCount);
+		buffers.gradients = reserve(buffers.outputsCount);
+		buffers.weightGradients = reserve(buffers.weightsCount);
+		buffers.biasGradients = reserve(buffers.outputsCount);
+
+		maxLayerSize = std::max(maxLayerSize, buffers.outputsCount);
+	}
+
+	m_batchInputs = reserve(maxLayerSize * BATCH_BLOCK_SIZE);
+	m_batchOutputs = reserve(maxLayerSize * BATCH_BLOCK_SIZE);
+
+	m_buffer.resize(m_bufferSize, T(0));
+}
+
+template<typename T>
+T* nn::Workspace<T>::getSums(size_t layer)
+{
+	return m_buffer.data() + m_layers[layer].sums;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getValues(size_t layer)
+{
+	return m_buffer.data() + m_layers[layer].values;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getGradients(size_t layer)
+{
+	return m_buffer.data() + m_layers[layer].gradients;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getWeightGradients(size_t layer)
+{
+	return m_buffer.data() + m_layers[layer].weightGradients;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getBiasGradients(size_t layer)
+{
+	return m_buffer.data() + m_layers[layer].biasGradients;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getBatchInputs()
+{
+	return m_buffer.data() + m_batchInputs;
+}
+
+template<typename T>
+T* nn::Workspace<T>::getBatchOutputs()
+{
+	return m_buffer.data() + m_batchOutputs;
+}
+
+template<typename T>
+void nn::Workspace<T>::clearGradients()
+{
+	for (auto& buffers : m_layers) {
+		std::fill_n(m_buffer.data() + buffers.weightGradients, buffers.weightsCount, T(0));
+		std::fill_n(m_buffer.data() + buffers.biasGradients, buffers.outputsCount, T(0));
+	}
+}
+
+template<typename T>
+size_t nn::Workspace<T>::reserve(size_t count)
+{
+	// Every buffer starts at the cache line boundary
+	const size_t alignment = 64 / sizeof(T);
+
+	size_t offset = m_bufferSize;
+	m_bufferSize += (count + alignment - 1) / alignment * alignment;
+
+	return offset;
+}
+
+template class nn::Workspace<float>;
+template class nn::Workspace<double>;
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "AlignedAllocator.h"
+
+namespace nn
+{
+	template<typename T>
+	class Network;
+
+	// All per-sample buffers needed to evaluate and train a network:
+	// layer sums and values, neuron gradients, weight gradient sums and batch
+	// scratch. They are carved out of one allocation made in the
+	// constructor, so reusing a workspace never allocates
+	template<typename T>
+	class Workspace
+	{
+	public:
+		// Batched evaluation processes samples in blocks of this size,
+		// so that intermediate values of the whole block stay in L1 cache
+		static const size_t BATCH_BLOCK_SIZE = 64;
+
+		Workspace(const Network<T>& network);
+
+		// Pre-activations and activations of the last sample fed forward
+		T* getSums(size_t layer);
+		T* getValues(size_t layer);
+		T* getGradients(size_t layer);
+		T* getWeightGradients(size_t layer);
+		T* getBiasGradients(size_t layer);
+
+		T* getBatchInputs();
+		T* getBatchOutputs();
+
+		// Zeroes gradient sums of all layers
+		void clearGradients();
+
+	private:
+		friend class Network<T>;
+
+		struct LayerBuffers
+		{
+			size_t sums;
+			size_t values;
+			size_t gradients;
+			size_t weightGradients;
+			size_t biasGradients;
+
+			size_t outputsCount;
+			size_t weightsCount;
+		};
+
+		size_t reserve(size_t count);
+
+		utils::AlignedVector<T> m_buffer;
+		size_t m_bufferSize;
+
+		std::vector<LayerBuffers> m_layers;
+		size_t m_batchInputs;
+		size_t m_batchOutputs;
+
+		T m_errorSum;
+	};
+}
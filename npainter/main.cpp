@@ -1,10 +1,19 @@
+#include <cstring>
+
 #include <QtWidgets/qapplication.h>
 #include <QtWidgets/qmessagebox.h>
 
+#include "ActivationKernels.h"
 #include "MainWindow.h"
 
 int main(int argc, char** argv)
 {
+	// Prints accuracy and speed of activation kernels instead of showing the window
+	if (argc > 1 && std::strcmp(argv[1], "--activation-report") == 0) {
+		nn::kernels::printPrecisionReport();
+		return 0;
+	}
+
 	QApplication::addLibraryPath("./");
 
 	QApplication app(argc, argv);